@@ -0,0 +1,164 @@
+//###########################################################################
+// This file is part of LImA, a Library for Image Acquisition
+//
+// Copyright (C) : 2009-2011
+// European Synchrotron Radiation Facility
+// BP 220, Grenoble 38043
+// FRANCE
+//
+// This is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This software is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//###########################################################################
+//
+// DhyanaBufferCtrlObj.h
+// Created on: October 24, 2018
+// Author: Arafat NOUREDDINE
+
+#ifndef DHYANABUFFERCTRLOBJ_H_
+#define DHYANABUFFERCTRLOBJ_H_
+
+#include <vector>
+#include "lima/Debug.h"
+#include "lima/HwInterface.h"
+#include "lima/HwBufferMgr.h"
+#include "DhyanaCompatibility.h"
+
+namespace lima
+{
+namespace Dhyana
+{
+
+const size_t BUFFER_ALIGNMENT        = 4096; // (bytes) alignment of each Lima buffer in the ring
+const double BUFFER_MAX_MEMORY_RATIO = 0.7;  // part of the physical memory the ring may use
+
+/*******************************************************************
+ * \class LargePageAllocMgr
+ * \brief allocate all the Lima buffers in a single ring, backed by
+ *        large pages when the system allows it, pre-faulted and locked
+ *        in memory before the acquisition starts.
+ *
+ * The ring is kept as long as the frame dimension and the number of
+ * buffers do not change, so that consecutive prepareAcq do not pay the
+ * allocation again. In shared mode (zero-copy) all the buffers share a
+ * single frame, only written by the blank frames.
+ *******************************************************************/
+class LIBDHYANA_API LargePageAllocMgr : public BufferAllocMgr
+{
+    DEB_CLASS_NAMESPC(DebModCamera, "LargePageAllocMgr", "Dhyana");
+
+public:
+    LargePageAllocMgr();
+    virtual ~LargePageAllocMgr();
+
+    virtual int  getMaxNbBuffers(const FrameDim& frame_dim);
+    virtual void allocBuffers(int nb_buffers, const FrameDim& frame_dim);
+    virtual const FrameDim& getFrameDim();
+    virtual void getNbBuffers(int& nb_buffers);
+    virtual void releaseBuffers();
+    virtual void* getBufferPtr(int buffer_nb);
+
+    // try large pages first (true by default), applied on the next allocation
+    void setLargePages(bool enable);
+    void getLargePages(bool& enable);
+    // allocate the ring on a NUMA node (-1 = anywhere), applied on the next allocation
+    void setNumaNode(int node);
+    // all the buffers share a single frame, applied on the next allocation
+    void setShared(bool shared);
+    // the current ring does not follow the requested layout
+    bool needsRealloc() const;
+    // last allocation : duration (s, pre-fault and lock included), size (bytes), large pages and lock obtained
+    void getAllocStats(double& alloc_time, size_t& ring_size, bool& large_pages, bool& locked);
+
+private:
+    bool allocLargePages(size_t size);
+    bool allocPages(size_t size);
+    void prefault();
+    bool lock();
+
+    FrameDim m_frame_dim;
+    int      m_nb_buffers;
+    size_t   m_buffer_size;  // frame size rounded up to BUFFER_ALIGNMENT
+    char*    m_ring;
+    size_t   m_ring_size;
+    bool     m_use_large_pages;
+    int      m_numa_node;
+    bool     m_shared;       // requested layout
+    bool     m_ring_shared;  // layout of the current ring
+    bool     m_large_pages;  // the ring is made of large pages
+    bool     m_locked;
+    double   m_alloc_time;
+} ;
+
+/*******************************************************************
+ * \class BufferCtrlObj
+ * \brief Lima buffer control object allocating its buffers with
+ *        LargePageAllocMgr
+ *
+ * In zero-copy mode the Lima buffers are the slots of the TUCAM frame
+ * reservation : their pointers are given by the DispatchThread for each
+ * frame, and their number is clamped to what the reservation can hold,
+ * so that Lima reports an overrun before TUCAM recycles a slot.
+ *******************************************************************/
+class LIBDHYANA_API BufferCtrlObj : public HwBufferCtrlObj
+{
+    DEB_CLASS_NAMESPC(DebModCamera, "BufferCtrlObj", "Dhyana");
+
+public:
+    BufferCtrlObj();
+    virtual ~BufferCtrlObj();
+
+    virtual void setFrameDim(const FrameDim& frame_dim);
+    virtual void getFrameDim(FrameDim& frame_dim);
+
+    virtual void setNbBuffers(int nb_buffers);
+    virtual void getNbBuffers(int& nb_buffers);
+
+    virtual void setNbConcatFrames(int nb_concat_frames);
+    virtual void getNbConcatFrames(int& nb_concat_frames);
+
+    virtual void getMaxNbBuffers(int& max_nb_buffers);
+
+    virtual void *getBufferPtr(int buffer_nb, int concat_frame_nb = 0);
+    virtual void *getFramePtr(int acq_frame_nb);
+
+    virtual void getStartTimestamp(Timestamp& start_ts);
+    virtual void getFrameInfo(int acq_frame_nb, HwFrameInfoType& info);
+
+    virtual void registerFrameCallback(HwFrameCallback& frame_cb);
+    virtual void unregisterFrameCallback(HwFrameCallback& frame_cb);
+
+    StdBufferCbMgr&    getBuffer();
+    LargePageAllocMgr& getAllocMgr();
+
+    // max_nb_buffers : nb of frames the TUCAM reservation can keep for Lima
+    void setZeroCopy(bool enable, int max_nb_buffers);
+    // reallocate the buffers if the mode changed since their allocation, called by prepareAcq
+    void prepareAlloc();
+    // TUCAM slot of a zero-copy frame, set before the frame is given to Lima
+    void setFramePtr(int acq_frame_nb, void* ptr);
+    // the TUCAM reservation is released, called before TUCAM_Buf_Release
+    void clearFramePtrs();
+
+private:
+    LargePageAllocMgr  m_alloc_mgr;
+    StdBufferCbMgr     m_buffer_cb_mgr;
+    BufferCtrlMgr      m_mgr;
+    bool               m_zero_copy;
+    int                m_zero_copy_max_nb_buffers;
+    std::vector<void*> m_frame_ptrs; // TUCAM slot of each zero-copy buffer
+} ;
+
+} // namespace Dhyana
+} // namespace lima
+
+#endif /* DHYANABUFFERCTRLOBJ_H_ */
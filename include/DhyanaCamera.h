@@ -30,8 +30,15 @@
 
 #include <ostream>
 #include <map>
+#include <vector>
 #include <process.h>
 #include "DhyanaCompatibility.h"
+#include "DhyanaFrameQueue.h"
+#include "DhyanaHistogram.h"
+#include "DhyanaFrameRate.h"
+#include "DhyanaPropertyCache.h"
+#include "DhyanaBufferCtrlObj.h"
+#include "DhyanaTopology.h"
 #include "lima/HwBufferMgr.h"
 #include "lima/HwInterface.h"
 #include "lima/Debug.h"
@@ -52,16 +59,36 @@ const int PIXEL_SIZE_HEIGHT_MICRON = 11; // pixel size is 11 micron
 const int PIXEL_NB_WIDTH  = 2048;
 const int PIXEL_NB_HEIGHT = 2048;
 
+// TUCAM frame reservation (uiRsdSize) used when the depth is computed automatically
+const int    SDK_BUFFER_MIN_DEPTH  = 2;
+const int    SDK_BUFFER_MAX_DEPTH  = 64;
+const double SDK_BUFFER_BURST_TIME = 0.5;                 // (s) of acquisition the SDK must be able to absorb
+const double SDK_BUFFER_MAX_MEMORY = 512. * 1024 * 1024;  // (bytes) upper bound of the SDK reservation
+const int    ZERO_COPY_SDK_MARGIN  = 2;                   // slots of the SDK reservation beyond the Lima buffers in zero-copy
+
+const int    DISPATCH_POLL_MS      = 10;                  // (ms) max sleep of a thread waiting on the frame queue
+const int    TRIGGER_HISTORY       = 100000;              // max nb of software trigger times kept per acquisition
+const double ACQ_START_TIMEOUT     = 2.0;                 // (s) deadline for the AcqThread to enter the capture loop
+const double ACQ_STOP_TIMEOUT      = 2.0;                 // (s) deadline for the AcqThread to leave the capture loop
+const double WATCHDOG_PERIOD_FACTOR = 10.;                // automatic watchdog timeout, in IntTrig periods
+const double WATCHDOG_MIN_TIMEOUT  = 1.0;                 // (s) lower bound of the automatic watchdog timeout
+const int    WATCHDOG_NB_CHECKS    = 4;                   // checks of the watchdog per timeout
+const int    SUB_FRAME_HISTORY     = 100000;              // max nb of stacked frames described per acquisition
+
 class BufferCtrlObj;
 class CSoftTriggerTimer;
+class CWatchdogTimer;
+class CopyEngine;
 
 /*******************************************************************
  * \class Camera
  * \brief object controlling the Dhyana camera
  *******************************************************************/
-class LIBDHYANA_API Camera
+class LIBDHYANA_API Camera : public HwMaxImageSizeCallbackGen
 {
     DEB_CLASS_NAMESPC(DebModCamera, "Camera", "Dhyana");
+    friend class CSoftTriggerTimer;
+    friend class CWatchdogTimer;
 
 public:
 
@@ -97,6 +124,12 @@ public:
       kSignalEdgeFalling = TUOPT_FAILING,
     };
 
+    enum InternalTriggerMode
+    {
+      kIntTrigTimer,   // IntTrig software triggers are issued on a fixed period by CSoftTriggerTimer
+      kIntTrigOnFrame  // the next software trigger is issued as soon as the previous frame is received
+    };
+
     enum TucamGain
     {
       kGainHDR  = TUGAIN_HDR,
@@ -104,7 +137,47 @@ public:
       kGainLow  = TUGAIN_LOW
     };
 
-    Camera(unsigned short timer_period_ms);
+    // stages of the acquisition loop timed by the latency histograms
+    enum LatencyStage
+    {
+      kStageWaitFrame,     // TUCAM_Buf_WaitForFrame
+      kStageCopy,          // copy of the frame into the Lima buffer
+      kStageNewFrameReady, // Lima newFrameReady
+      kStageFramePeriod,   // time between two frames returned by TUCAM
+      kNbLatencyStages
+    };
+
+    // acquisition control state, every transition is made with m_cond locked
+    enum AcqState
+    {
+      kAcqIdle,     // no capture started
+      kAcqArmed,    // capture started by prepareAcq, waiting for startAcq
+      kAcqRunning,  // AcqThread in the capture loop
+      kAcqStopping, // stop requested, waiting for the AcqThread to leave the capture loop
+      kAcqFault,    // a transition missed its deadline, left by reset()
+      kNbAcqStates
+    };
+
+    // gap in the TUCAM frame index sequence
+    struct FrameGap
+    {
+        int      hw_frame_nb;  // position of the first missing frame in the TUCAM frames of the acquisition
+        unsigned hw_index;     // first missing TUCAM frame index (uiIndex)
+        int      nb_frames;    // number of missing frames
+    };
+
+    // TUCAM frame stacked into a Lima frame
+    struct SubFrame
+    {
+        unsigned hw_index;  // TUCAM frame index (uiIndex)
+        double   timestamp; // (s) arrival time, relative to the acquisition start timestamp
+        bool     blank;     // placeholder of a dropped frame
+    };
+
+    // timer_period_ms : minimum period of the IntTrig software triggers, the actual period is max(exposure + latency, timer_period_ms)
+    // nb_copy_threads : size of the worker pool copying frames by stripes (0 = copy in DispatchThread only)
+    // numa_node : NUMA node the acquisition threads, the copy workers and the Lima buffers are bound to (-1 = none)
+    Camera(unsigned short timer_period_ms, int nb_copy_threads = 0, int numa_node = -1);
     virtual ~Camera();
 
     void init();
@@ -122,10 +195,19 @@ public:
     void getDetectorType(std::string& type);
     void getDetectorModel(std::string& model);
     void getDetectorImageSize(Size& size);
+    void getMaxImageSize(Size& size);
+    void getImageSize(Size& size);
     void getPixelSize(double& sizex, double& sizey);
 
     // -- Buffer control object
     HwBufferCtrlObj* getBufferCtrlObj();
+    // the Lima buffers are a single ring of large pages (if enabled and allowed), pre-faulted and locked in memory
+    void setLargePages(bool enable);
+    void getLargePages(bool& enable);
+    // last allocation of the ring : duration (s), size (bytes), large pages and lock obtained
+    void getBufferAllocStats(double& alloc_time, size_t& ring_size, bool& large_pages, bool& locked);
+    // NUMA nodes of the host, node and cpus the acquisition is bound to (-1 and empty if not bound)
+    void getCpuBinding(int& nb_nodes, int& numa_node, std::vector<int>& cpus);
 
     //-- Synch control object
     void setTrigMode(TrigMode mode);
@@ -147,9 +229,16 @@ public:
     //-- Related to Bin control object
     void setBin(const Bin& bin);
     void getBin(Bin& bin);
+    // binning of the TUIDC_RESOLUTION modes of the camera
+    void getHwBinModes(std::vector<Bin>& hw_bins);
+    // split of the current binning between the camera and the software
+    void getBinSplit(Bin& hw_bin, Bin& soft_bin);
     void checkBin(Bin& bin);
 
     //-- Related to Roi control object
+    // size of a TUCAM frame without roi, in pixels of the hardware binning
+    void getResolutionSize(Size& size);
+    // throws if the roi does not fit in one TUCAM frame
     void checkRoi(const Roi& set_roi, Roi& hw_roi);
     void setRoi(const Roi& set_roi);
     void getRoi(Roi& hw_roi);
@@ -165,18 +254,124 @@ public:
     void getFanSpeed(unsigned& speed);
     void setGlobalGain(unsigned gain);
     void getGlobalGain(unsigned& gain);
+    // TUCAM properties, capabilities and roi are read once then served from a cache, invalidated on set and on reset.
+    // In verify mode they are also read from the camera on each get, and compared with the cache
+    void setCacheVerify(bool enable);
+    void getCacheVerify(bool& enable);
+    void invalidateCache();
+    void getCacheStats(int& nb_hits, int& nb_misses, int& nb_mismatches);
     void getTucamVersion(std::string& version);
     void getFirmwareVersion(std::string& version);
     bool isAcqRunning() const;
 
+    // frame rate over the last FRAME_RATE_WINDOW
     void getFPS(double& fps);	
+    // instant_fps : from the moving average of the frame period
+    // min_window_fps : lowest rate over FRAME_RATE_WINDOW seen during the acquisition
+    void getFrameRate(double& instant_fps, double& window_fps, double& min_window_fps);
+    // a stall is a time between two frames longer than stall_factor times the expected period
+    void getFrameStalls(int& nb_stalls, double& max_gap);
+    // (s) since the last frame given to Lima, 0 before the first one
+    void getTimeSinceLastFrame(double& time);
+    void setFrameStallFactor(double stall_factor);
+    void getFrameStallFactor(double& stall_factor);
     void getTriggerMode(TucamTriggerMode& mode);
     void setTriggerMode(TucamTriggerMode mode);
+    void getInternalTriggerMode(InternalTriggerMode& mode);
+    void setInternalTriggerMode(InternalTriggerMode mode);
     void getTriggerEdge(TucamTriggerEdge& edge);
     void setTriggerEdge(TucamTriggerEdge edge);
     void getOutputSignal(int port, TucamSignal& signal, TucamSignalEdge& edge, int& delay, int& width);
     void setOutputSignal(int port, TucamSignal signal, TucamSignalEdge edge=kSignalEdgeRising, int delay=-1, int width=-1);
 
+    // zero-copy : Lima buffers are the slots of the TUCAM reservation instead of copies.
+    // The reservation is sized from the Lima nb of buffers (at most SDK_BUFFER_MAX_DEPTH - ZERO_COPY_SDK_MARGIN),
+    // so that a Lima processing backlog is reported as an overrun before TUCAM recycles a slot.
+    void setZeroCopy(bool enable);
+    void getZeroCopy(bool& enable);
+
+    // depth of the TUCAM frame reservation (uiRsdSize), 0 means computed from exposure and frame size
+    void setSdkBufferDepth(int depth);
+    void getSdkBufferDepth(int& depth);
+    // deepest backlog of frames observed in the TUCAM reservation during the last acquisition
+    void getSdkBufferMaxUsage(int& usage);
+
+    // frame queue between AcqThread (TUCAM_Buf_WaitForFrame) and DispatchThread (copy & newFrameReady)
+    void getFrameQueueStats(int& high_water_mark, int& nb_stalls);
+    // TUCAM was seen returning a frame in a buffer of the reservation still used by one of the previous frames :
+    // frames are then copied one at a time (queue of 1) and zero-copy is refused
+    void getSdkBufferReuse(bool& reuse);
+
+    void getNbCopyThreads(int& nb_threads);
+    void getCopyKernel(std::string& kernel);
+
+    // IntTrig acquisitions of several frames without latency are streamed in TUCCM_SEQUENCE mode (default),
+    // disable it to always send one software trigger per frame
+    void setSequenceMode(bool enable);
+    void getSequenceMode(bool& enable);
+
+    // keep the capture started between IntTrig acquisitions in software trigger mode,
+    // it is only restarted when the configuration changes
+    void setKeepArmed(bool enable);
+    void getKeepArmed(bool& enable);
+    // duration (s) of the last prepareAcq and startAcq, and whether the capture had to be started
+    void getSetupTimes(double& prepare_time, double& start_time, bool& rearmed);
+    void getNbArms(int& nb_arms, int& nb_reuses);
+
+    // step scan : the next IntTrig acquisition (nb_frames = nb_points * frames_per_point) runs as one
+    // Lima acquisition, the frames of each point are only triggered when nextPoint() is called
+    void armScan(int nb_points, int frames_per_point);
+    void nextPoint();
+    void getScanProgress(int& nb_points_released, int& nb_points_done);
+    // time (s) between nextPoint() and the first trigger of the point
+    void getScanDeadTime(int& count, double& p50, double& p99, double& max_dead_time);
+
+    // deferred commit : setExpTime, setTrigMode and setRoi only stage their value, prepareAcq writes the ones
+    // that differ from the camera (roi, then trigger mode, then exposure) and logs what was written
+    void setDeferredCommit(bool enable);
+    void getDeferredCommit(bool& enable);
+    void getCommitLog(std::vector<std::string>& log, double& commit_time);
+
+    // frames missing (dropped) or received twice (duplicated) in the TUCAM index sequence, since the camera creation
+    void getDroppedFrames(int& nb_dropped, int& nb_duplicated);
+    void resetDroppedFrames();
+    // gaps of the last acquisition
+    void getFrameGaps(std::vector<FrameGap>& gaps);
+    // push a blank frame to Lima for each dropped frame, so that Lima frame numbers follow the hardware ones
+    void setFillDroppedFrames(bool enable);
+    void getFillDroppedFrames(bool& enable);
+
+    // nb of TUCAM frames stacked one under the other in each Lima frame (1 = no stacking),
+    // the Lima image is nb_frames x the roi height and the Lima rois are given on the stacked image
+    void setNbStackedFrames(int nb_frames);
+    void getNbStackedFrames(int& nb_frames);
+    // TUCAM frames stacked in a Lima frame of the last acquisition
+    void getSubFrames(int acq_frame_nb, std::vector<SubFrame>& sub_frames);
+
+    // delay (s) between each software trigger deadline and the actual trigger, for the last IntTrig acquisition
+    void getTriggerJitter(std::vector<double>& jitter);
+    void getTriggerJitterStats(int& nb_triggers, int& nb_missed, double& mean_jitter, double& max_jitter);
+    // durations (s) of each stage of the acquisition loop, for the last acquisition
+    void getLatencyStats(LatencyStage stage, int& count, double& p50, double& p99, double& max_latency);
+    void getLatencyHistogram(LatencyStage stage, std::vector<double>& bounds, std::vector<int>& counts);
+
+    // time (s, relative to the acquisition start timestamp) at which each software trigger of the last acquisition was sent,
+    // frame times are given by HwFrameInfoType::frame_timestamp
+    void getTriggerTimestamps(std::vector<double>& timestamps);
+
+    // state of the acquisition control
+    void getAcqState(AcqState& state);
+    // durations (s) of the transitions into a state, since the camera creation :
+    // prepareAcq -> Armed, startAcq -> Running, stop request -> Stopping then Idle or Armed, deadline -> Fault
+    void getTransitionStats(AcqState state, int& count, double& p50, double& p99, double& max_latency);
+
+    // no frame returned by TUCAM_Buf_WaitForFrame within timeout (s) : the capture is restarted and the acquisition goes on.
+    // 0 = automatic (WATCHDOG_PERIOD_FACTOR x trigger period, IntTrig only), < 0 = disabled
+    void setWatchdogTimeout(double timeout);
+    void getWatchdogTimeout(double& timeout);
+    // restarts of the capture since the camera creation, and their durations (s)
+    void getWatchdogStats(int& nb_recoveries, int& nb_failures, double& p50_recovery_time, double& max_recovery_time);
+
 	//TUCAM stuff, use TUCAM notations !
 	TUCAM_INIT          m_itApi; // TUCAM handle Api
 	TUCAM_OPEN          m_opCam; // TUCAM handle camera
@@ -184,8 +379,31 @@ public:
 	HANDLE              m_hThdEvent; // TUCAM handle event   
 private:
     //read/copy frame
-    bool readFrame(void *bptr, int& frame_nb);
+    bool readFrame(const FrameQueue::Desc& frame, void *bptr, int& frame_nb);
+    size_t getLimaFrameSize(const FrameQueue::Desc& frame) const;
+    bool isSoftBinning() const;
+    int  computeSdkBufferDepth();
+    bool checkFrameIndex(unsigned hw_index, int& nb_missing);
+    void newFrameReady(StdBufferCbMgr& buffer_mgr, HwFrameInfoType& frame_info);
+    void dispatchFrame(StdBufferCbMgr& buffer_mgr, const FrameQueue::Desc& frame, unsigned hw_index, bool blank);
+    bool sendSoftwareTrigger();
+    void disarm();
+    void releaseReservation();
+    void disarmForChange();
+    void initBinModes();
+    void commitConfig();
+    void applyExpTime(double exp_time);
+    void applyTrigMode(TrigMode mode);
+    void applyRoi(const Roi& set_roi);
     void setStatus(Camera::Status status, bool force);
+    void beginTransition();
+    void setAcqState(AcqState state);
+    void setFault();
+    bool waitCaptureEnd(double timeout);
+    void finishAcq();
+    double computeWatchdogTimeout();
+    void checkWatchdog();
+    bool recoverCapture();
     inline bool IS_POWER_OF_2(long x)
     {
         if( ((x ^ (x - 1)) == x + (x - 1)) && (x != 0) )
@@ -202,30 +420,115 @@ private:
     //////////////////////////////
 
     class AcqThread;
+    class DispatchThread;
 
     AcqThread *         m_acq_thread;
+    DispatchThread *    m_dispatch_thread;
     TrigMode            m_trigger_mode;
     double              m_exp_time;
     double              m_lat_time;
     ImageType           m_image_type;
     int                 m_nb_frames; // nos of frames to acquire
-    bool                m_thread_running;
-    bool                m_wait_flag;
-    bool                m_quit;
-    int                 m_acq_frame_nb; // nos of frames acquired
+    // shared between the client, the AcqThread and the DispatchThread : read without any lock
+    std::atomic<AcqState> m_acq_state;
+    std::atomic<bool>   m_quit;         // AcqThread and DispatchThread destruction
+    std::atomic<int>    m_acq_frame_nb; // nos of frames acquired, written by the DispatchThread only
     mutable             Cond m_cond;
     long                m_depth;
-    Camera::Status      m_status;
+    std::atomic<Camera::Status> m_status;
     Bin                 m_bin;
+    Bin                 m_hw_bin;     // binning of the current TUIDC_RESOLUTION mode
+    Bin                 m_soft_bin;   // binning done by CopyKernel::bin in readFrame
+    std::vector<Bin>    m_hw_bins;    // binned TUIDC_RESOLUTION modes ...
+    std::vector<int>    m_hw_bin_modes; // ... and their TUIDC_RESOLUTION value
+    int                 m_full_resolution; // TUIDC_RESOLUTION value of the unbinned mode (-1 if unknown)
     double              m_temperature_target;
     // Buffer control object
-    SoftBufferCtrlObj   m_bufferCtrlObj;
+    BufferCtrlObj       m_bufferCtrlObj;
 	CSoftTriggerTimer*	m_internal_trigger_timer;
-    double              m_fps;
+    CWatchdogTimer*     m_watchdog_timer;
+    double              m_watchdog_timeout;      // requested timeout (0 = auto, < 0 = disabled)
+    double              m_watchdog_timeout_used; // timeout of the running acquisition (0 = disabled)
+    std::atomic<double> m_frame_wait_start;      // CBaseTimer::now() when TUCAM_Buf_WaitForFrame was entered, 0 outside
+    std::atomic<bool>   m_watchdog_fired;        // TUCAM_Buf_WaitForFrame aborted by the watchdog
+    std::atomic<int>    m_nb_recoveries;
+    std::atomic<int>    m_nb_recovery_failures;
+    LatencyHistogram    m_recovery_time;
+    FrameRateMeter      m_frame_rate;
+    double              m_frame_stall_factor;
 	unsigned short 		m_timer_period_ms;
+    bool                m_zero_copy;
+    int                 m_sdk_buffer_depth;      // requested depth (0 = auto)
+    int                 m_sdk_buffer_depth_used; // depth given to TUCAM_Buf_Alloc
+    bool                m_sdk_buffer_allocated;  // TUCAM_Buf_Alloc done, not yet released
+    bool                m_sdk_buffer_lent;       // the reservation was given to Lima (zero-copy)
+    std::atomic<int>    m_sdk_buffer_max_usage;
+    std::atomic<bool>   m_sdk_buffer_reuse;      // TUCAM does not keep each frame for the whole reservation
+    std::atomic<bool>   m_sdk_buffer_cycle_seen; // every buffer of the armed reservation was returned once
+    FrameQueue          m_frame_queue;
+    CopyEngine*         m_copy_engine;
+    int                 m_numa_node;
+    std::vector<int>    m_acq_cpus;           // cpus of m_numa_node
+    HANDLE              m_frame_ready_event;  // set by AcqThread on push
+    HANDLE              m_frame_free_event;   // set by DispatchThread on pop
+    std::atomic<bool>   m_dispatch_continue;  // false once Lima refused a frame
+    std::atomic<int>    m_nb_queue_stalls;
+    double              m_acq_start_time;     // CBaseTimer::now() when the Lima start timestamp is set
+    std::vector<double> m_trigger_times;      // CBaseTimer::now() of each software trigger
+    Mutex               m_trigger_times_lock;
+    LatencyHistogram    m_latency[kNbLatencyStages];
+    int                 m_start_request;      // incremented by startAcq, the AcqThread starts once per request
+    int                 m_start_ack;          // last start request taken by the AcqThread
+    AcqState            m_fault_state;        // state in which the deadline was missed
+    double              m_transition_start;   // CBaseTimer::now() at which the current transition was requested
+    LatencyHistogram    m_transition_latency[kNbAcqStates];
+    bool                m_keep_armed;
+    bool                m_prepare_rearmed;    // last prepareAcq had to start the capture
+    int                 m_nb_arms;
+    int                 m_nb_arm_reuses;
+    std::atomic<int>    m_nb_armed_triggers;  // software triggers sent since the capture was started
+    std::atomic<int>    m_nb_armed_frames;    // frames received since the capture was started
+    int                 m_nb_stale_frames;    // frames of the previous acquisition to skip
+    double              m_prepare_time;       // (s) duration of the last prepareAcq
+    double              m_start_time;         // (s) duration of the last startAcq
+    bool                m_scan_armed;         // next acquisition is a step scan
+    int                 m_scan_nb_points;
+    int                 m_scan_frames_per_point;
+    std::atomic<int>    m_scan_points_released;
+    std::atomic<double> m_scan_release_time;  // CBaseTimer::now() of the last nextPoint()
+    HANDLE              m_scan_event;         // set by nextPoint
+    LatencyHistogram    m_scan_dead_time;
+    PropertyCache       m_prop_cache;
+    bool                m_deferred_commit;
+    bool                m_staged_exp_time_set;
+    double              m_staged_exp_time;
+    bool                m_staged_trig_mode_set;
+    TrigMode            m_staged_trig_mode;
+    bool                m_staged_roi_set;
+    Roi                 m_staged_roi;
+    double              m_applied_exp_time;   // last exposure written to TUCAM (-1 = never)
+    bool                m_trig_mode_applied;  // TUCAM_Cap_SetTrigger done at least once
+    std::vector<std::string> m_commit_log;    // values written by the last commitConfig
+    double              m_commit_time;        // (s) duration of the last commitConfig
+    bool                m_fill_dropped_frames;
+    bool                m_hw_index_valid;     // false until the first frame of the acquisition
+    unsigned            m_hw_index_expected;
+    int                 m_hw_frame_nb;        // TUCAM frames of the acquisition so far, dropped ones included
+    std::atomic<int>    m_nb_dropped_frames;
+    std::atomic<int>    m_nb_duplicated_frames;
+    std::vector<FrameGap> m_frame_gaps;
+    Mutex               m_frame_gaps_lock;
+    int                 m_nb_stacked_frames;
+    int                 m_stack_fill;         // TUCAM frames already copied in the current Lima frame, DispatchThread only
+    double              m_stack_timestamp;    // arrival time of the first TUCAM frame of the current Lima frame
+    std::vector<SubFrame> m_sub_frames;       // written by the DispatchThread, sized by startAcq
+    std::atomic<int>    m_nb_sub_frames;
     
     //TUCAM stuff, use TUCAM notations !
     TucamTriggerMode    m_tucam_trigger_mode;
+    InternalTriggerMode m_int_trigger_mode;
+    bool                m_sequence_mode;  // TUCCM_SEQUENCE allowed for IntTrig
+    int                 m_capture_mode;   // TUCCM mode given to TUCAM_Cap_Start
     TucamTriggerEdge    m_tucam_trigger_edge_mode;
     TUCAM_TRGOUT_ATTR m_tgroutAttr1;
     TUCAM_TRGOUT_ATTR m_tgroutAttr2;
@@ -251,6 +554,24 @@ private:
     Camera& m_cam;
 } ;
 
+/*******************************************************************
+ * \class DispatchThread
+ * \brief Thread copying the queued frames and pushing them to Lima
+ *******************************************************************/
+class Camera::DispatchThread : public Thread
+{
+    DEB_CLASS_NAMESPC(DebModCamera, "Camera", "DispatchThread");
+public:
+    DispatchThread(Camera &aCam);
+    virtual ~DispatchThread();
+
+protected:
+    virtual void threadFunction();
+
+private:
+    Camera& m_cam;
+} ;
+
 } // namespace Dhyana
 } // namespace lima
 
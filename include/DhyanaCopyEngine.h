@@ -0,0 +1,115 @@
+//###########################################################################
+// This file is part of LImA, a Library for Image Acquisition
+//
+// Copyright (C) : 2009-2011
+// European Synchrotron Radiation Facility
+// BP 220, Grenoble 38043
+// FRANCE
+//
+// This is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This software is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//###########################################################################
+//
+// DhyanaCopyEngine.h
+// Created on: October 24, 2018
+// Author: Arafat NOUREDDINE
+
+#ifndef DHYANACOPYENGINE_H_
+#define DHYANACOPYENGINE_H_
+
+#include <vector>
+#include "lima/Debug.h"
+#include "lima/ThreadUtils.h"
+#include "DhyanaCompatibility.h"
+
+namespace lima
+{
+namespace Dhyana
+{
+
+// frames smaller than this are copied by the calling thread alone
+const size_t COPY_ENGINE_MIN_SIZE = 1024 * 1024;
+
+/*******************************************************************
+ * \class CopyEngine
+ * \brief copy (or bin) a frame by row stripes on a pool of pinned worker threads
+ *
+ * The calling thread copies the first stripe itself, so a pool of N
+ * workers splits each frame into N+1 stripes.
+ *******************************************************************/
+class LIBDHYANA_API CopyEngine
+{
+    DEB_CLASS_NAMESPC(DebModCamera, "CopyEngine", "Dhyana");
+
+public:
+    // the workers are pinned on cpus (all the cpus if empty), the first one excepted
+    CopyEngine(int nb_threads, const std::vector<int>& cpus);
+    ~CopyEngine();
+
+    int  getNbThreads() const;
+    // copy nb_rows rows of row_size bytes, src_stride bytes apart in src, see CopyKernel::copyRows
+    void copy(void* dst, const void* src, size_t src_stride, size_t row_size, int nb_rows);
+    // software binning of a 16 bits frame, see CopyKernel::bin
+    void bin(void* dst, int dst_depth, const void* src, size_t src_stride, int width, int height, int bin_x, int bin_y);
+
+private:
+    class Worker;
+
+    void run();
+    void copyStripe(int stripe);
+    void binStripe(int stripe);
+
+    std::vector<Worker*> m_workers;
+    Cond                 m_cond;
+    bool                 m_quit;
+    int                  m_job_id;   // incremented for each new frame
+    int                  m_nb_done;  // nb of workers done with the current frame
+
+    // current frame
+    unsigned char*       m_dst;
+    const unsigned char* m_src;
+    size_t               m_src_stride; // bytes between two src rows
+    size_t               m_row_size;   // bytes of a dst row (copy only)
+    int                  m_nb_rows;  // rows of dst
+    bool                 m_binning;
+    int                  m_dst_depth;
+    int                  m_width;    // pixels of a src row
+    int                  m_bin_x;
+    int                  m_bin_y;
+} ;
+
+/*******************************************************************
+ * \class CopyEngine::Worker
+ * \brief Thread copying one stripe of each frame
+ *******************************************************************/
+class CopyEngine::Worker : public Thread
+{
+    DEB_CLASS_NAMESPC(DebModCamera, "CopyEngine", "Worker");
+public:
+    Worker(CopyEngine& engine, int stripe, int cpu);
+    virtual ~Worker();
+
+protected:
+    virtual void threadFunction();
+
+private:
+    CopyEngine& m_engine;
+    int         m_stripe;
+    int         m_cpu;
+    int         m_job_id;   // last job seen, taken at construction so that no job is missed before the thread runs
+} ;
+
+} // namespace Dhyana
+} // namespace lima
+
+#endif /* DHYANACOPYENGINE_H_ */
@@ -0,0 +1,77 @@
+//###########################################################################
+// This file is part of LImA, a Library for Image Acquisition
+//
+// Copyright (C) : 2009-2011
+// European Synchrotron Radiation Facility
+// BP 220, Grenoble 38043
+// FRANCE
+//
+// This is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This software is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//###########################################################################
+//
+// DhyanaCopyKernel.h
+// Created on: October 24, 2018
+// Author: Arafat NOUREDDINE
+
+#ifndef DHYANACOPYKERNEL_H_
+#define DHYANACOPYKERNEL_H_
+
+#include <stddef.h>
+#include "lima/Debug.h"
+#include "DhyanaCompatibility.h"
+
+namespace lima
+{
+namespace Dhyana
+{
+
+// below this size the streaming stores do not pay off, memcpy is used
+const size_t COPY_KERNEL_MIN_STREAM_SIZE = 256 * 1024;
+
+/*******************************************************************
+ * \class CopyKernel
+ * \brief frame copy using non-temporal (streaming) stores, so that
+ *        frames written into Lima buffers do not evict the LLC.
+ *
+ * The widest kernel supported by the cpu and the OS is selected once
+ * by CPUID when the library is loaded. The software binning uses the
+ * AVX2 kernel when available (also on AVX-512 cpus).
+ *******************************************************************/
+class LIBDHYANA_API CopyKernel
+{
+    DEB_CLASS_NAMESPC(DebModCamera, "CopyKernel", "Dhyana");
+
+public:
+    enum Type
+    {
+        kMemcpy, kSSE2, kAVX2, kAVX512
+    } ;
+
+    static Type        getType();
+    static const char* getName();
+    static void        copy(void* dst, const void* src, size_t size);
+    // copy nb_rows rows of row_size bytes, src_stride bytes apart, into contiguous rows of dst
+    static void        copyRows(void* dst, const void* src, size_t src_stride, size_t row_size, int nb_rows);
+    // sum bin_x x bin_y blocks of 16 bits pixels into 16 (saturated) or 32 bits pixels,
+    // the src rows are src_stride bytes apart (>= 2 x width), the dst rows are contiguous,
+    // height is a multiple of bin_y, the pixels beyond the last full block of a row are dropped
+    static void        bin(void* dst, int dst_depth, const void* src, size_t src_stride, int width, int height, int bin_x, int bin_y);
+
+    static Type detect();
+} ;
+
+} // namespace Dhyana
+} // namespace lima
+
+#endif /* DHYANACOPYKERNEL_H_ */
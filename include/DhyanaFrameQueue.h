@@ -0,0 +1,128 @@
+//###########################################################################
+// This file is part of LImA, a Library for Image Acquisition
+//
+// Copyright (C) : 2009-2011
+// European Synchrotron Radiation Facility
+// BP 220, Grenoble 38043
+// FRANCE
+//
+// This is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This software is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//###########################################################################
+//
+// DhyanaFrameQueue.h
+// Created on: October 24, 2018
+// Author: Arafat NOUREDDINE
+
+#ifndef DHYANAFRAMEQUEUE_H_
+#define DHYANAFRAMEQUEUE_H_
+
+#include <vector>
+#include <atomic>
+#include "DhyanaCompatibility.h"
+
+namespace lima
+{
+namespace Dhyana
+{
+
+/*******************************************************************
+ * \class FrameQueue
+ * \brief bounded lock-free single-producer/single-consumer ring of
+ *        frames returned by TUCAM_Buf_WaitForFrame.
+ *
+ * The producer (AcqThread) only calls push(), the consumer
+ * (DispatchThread) only calls front() then pop() once it is done with
+ * the frame memory, so size() is the number of TUCAM frames still in use.
+ *******************************************************************/
+class LIBDHYANA_API FrameQueue
+{
+public:
+
+    struct Desc
+    {
+        unsigned char* ptr;   // frame data (pBuffer + usOffset)
+        unsigned       size;  // frame size in bytes without the row padding (usWidth x usHeight x ucElemBytes)
+        unsigned       index; // TUCAM frame index (uiIndex)
+        unsigned short width; // frame width in pixels (usWidth)
+        unsigned short height;// frame height in pixels (usHeight)
+        unsigned       stride;// bytes between two rows of the TUCAM frame (uiWidthStep), >= size / height
+        int            nb_missing; // frames dropped by the camera just before this one
+        double         timestamp;  // (s) CBaseTimer::now() when TUCAM_Buf_WaitForFrame returned
+    };
+
+    FrameQueue() : m_capacity(1), m_ring(1), m_head(0), m_tail(0), m_high_water_mark(0)
+    {
+    }
+
+    // must only be called while both producer and consumer are idle
+    void reset(int capacity)
+    {
+        m_capacity = (capacity < 1) ? 1 : capacity;
+        m_ring.resize(m_capacity);
+        m_head.store(0, std::memory_order_relaxed);
+        m_tail.store(0, std::memory_order_relaxed);
+        m_high_water_mark = 0;
+    }
+
+    //-- producer side
+    bool push(const Desc& desc)
+    {
+        unsigned head = m_head.load(std::memory_order_relaxed);
+        unsigned tail = m_tail.load(std::memory_order_acquire);
+        int used = (int) (head - tail);
+        if(used >= m_capacity)
+            return false;
+        m_ring[head % m_capacity] = desc;
+        m_head.store(head + 1, std::memory_order_release);
+        if(used + 1 > m_high_water_mark)
+            m_high_water_mark = used + 1;
+        return true;
+    }
+
+    //-- consumer side
+    bool front(Desc& desc) const
+    {
+        unsigned tail = m_tail.load(std::memory_order_relaxed);
+        if(tail == m_head.load(std::memory_order_acquire))
+            return false;
+        desc = m_ring[tail % m_capacity];
+        return true;
+    }
+
+    void pop()
+    {
+        m_tail.store(m_tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    //-- statistics, high water mark is updated by the producer only
+    int size() const
+    {
+        return (int) (m_head.load(std::memory_order_acquire) - m_tail.load(std::memory_order_acquire));
+    }
+    int capacity() const        { return m_capacity; }
+    int getHighWaterMark() const { return m_high_water_mark; }
+
+private:
+    int                   m_capacity;
+    std::vector<Desc>     m_ring;
+    std::atomic<unsigned> m_head;   // next slot written by the producer
+    char                  m_pad[64];// keep head and tail on separate cache lines
+    std::atomic<unsigned> m_tail;   // next slot released by the consumer
+    int                   m_high_water_mark;
+} ;
+
+} // namespace Dhyana
+} // namespace lima
+
+#endif /* DHYANAFRAMEQUEUE_H_ */
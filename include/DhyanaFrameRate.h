@@ -0,0 +1,105 @@
+//###########################################################################
+// This file is part of LImA, a Library for Image Acquisition
+//
+// Copyright (C) : 2009-2011
+// European Synchrotron Radiation Facility
+// BP 220, Grenoble 38043
+// FRANCE
+//
+// This is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This software is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//###########################################################################
+//
+// DhyanaFrameRate.h
+// Created on: October 24, 2018
+// Author: Arafat NOUREDDINE
+
+#ifndef DHYANAFRAMERATE_H_
+#define DHYANAFRAMERATE_H_
+
+#include <vector>
+#include <atomic>
+#include "lima/ThreadUtils.h"
+#include "DhyanaCompatibility.h"
+
+namespace lima
+{
+namespace Dhyana
+{
+
+const double FRAME_RATE_WINDOW      = 1.0;  // (s) length of the sliding window
+const int    FRAME_RATE_MAX_SAMPLES = 4096; // max nb of frames kept in the sliding window
+const double FRAME_RATE_EWMA_ALPHA  = 0.1;  // weight of the last period in the moving average
+const double FRAME_STALL_FACTOR     = 3.0;  // a gap longer than this times the expected period is a stall
+
+/*******************************************************************
+ * \class FrameRateMeter
+ * \brief frame rate over a sliding window and frame stall detector
+ *
+ * add() is called by a single thread for each frame, the results can be
+ * read at any time from another thread. The window rate and the stalls
+ * are computed at read time, so that they also account for the frames
+ * that did not come since the last one, until stop() freezes them.
+ *******************************************************************/
+class LIBDHYANA_API FrameRateMeter
+{
+public:
+    FrameRateMeter();
+
+    // must only be called while no thread is adding frames.
+    // expected_period (s) : 0 if unknown, the moving average of the period is then used
+    void reset(double expected_period, double stall_factor = FRAME_STALL_FACTOR);
+
+    //-- writer side, frame_time (s) from a monotonic clock
+    void add(double frame_time);
+    // end of the acquisition : the results are then given at the last frame time
+    void stop();
+
+    //-- reader side, now (s) from the clock given to add()
+    double getInstantRate() const;   // from the moving average of the period
+    double getWindowRate(double now) const;  // over the last FRAME_RATE_WINDOW
+    double getMinWindowRate() const; // lowest window rate since reset, once a full window has been seen
+    double getAverageRate() const;   // since the first frame
+    int    getNbStalls(double now) const;    // the current gap included
+    double getMaxGap(double now) const;      // (s) longest time between two frames, the current gap included
+    double getTimeSinceLastFrame(double now) const; // (s) 0 before the first frame
+
+private:
+    double getReadTime(double now) const;
+    bool   isStalled(double now) const;
+
+    mutable Mutex       m_lock;
+    bool                m_stopped;
+    double              m_expected_period;
+    double              m_stall_factor;
+
+    // written under m_lock
+    std::vector<double> m_times;     // ring of the last frame times
+    int                 m_first;     // oldest frame of the window in m_times
+    int                 m_nb_times;
+    int                 m_nb_frames;
+    double              m_start_time;
+    double              m_last_time;
+    double              m_ewma_period;
+
+    std::atomic<double> m_instant_rate;
+    std::atomic<double> m_min_window_rate;
+    std::atomic<double> m_average_rate;
+    std::atomic<int>    m_nb_stalls;
+    std::atomic<double> m_max_gap;
+} ;
+
+} // namespace Dhyana
+} // namespace lima
+
+#endif /* DHYANAFRAMERATE_H_ */
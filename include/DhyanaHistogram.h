@@ -0,0 +1,85 @@
+//###########################################################################
+// This file is part of LImA, a Library for Image Acquisition
+//
+// Copyright (C) : 2009-2011
+// European Synchrotron Radiation Facility
+// BP 220, Grenoble 38043
+// FRANCE
+//
+// This is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This software is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//###########################################################################
+//
+// DhyanaHistogram.h
+// Created on: October 24, 2018
+// Author: Arafat NOUREDDINE
+
+#ifndef DHYANAHISTOGRAM_H_
+#define DHYANAHISTOGRAM_H_
+
+#include <vector>
+#include <atomic>
+#include "DhyanaCompatibility.h"
+
+namespace lima
+{
+namespace Dhyana
+{
+
+// buckets cover [HISTOGRAM_MIN_TIME, HISTOGRAM_MIN_TIME * 2^HISTOGRAM_NB_OCTAVES[,
+// each octave is split in HISTOGRAM_BUCKETS_PER_OCTAVE buckets of equal width
+const double HISTOGRAM_MIN_TIME         = 1e-6;  // (s) upper bound of the first bucket
+const int    HISTOGRAM_NB_OCTAVES       = 28;    // up to ~268 s
+const int    HISTOGRAM_BUCKETS_PER_OCTAVE = 4;   // bucket width of 25% down to 14% of its lower bound
+const int    HISTOGRAM_NB_BUCKETS       = HISTOGRAM_NB_OCTAVES * HISTOGRAM_BUCKETS_PER_OCTAVE + 1;
+
+/*******************************************************************
+ * \class LatencyHistogram
+ * \brief fixed-bucket histogram of durations, octaves split in linear buckets
+ *
+ * add() is lock-free and meant to be called by a single thread in the
+ * acquisition hot path, the statistics can be read at any time from
+ * another thread.
+ *******************************************************************/
+class LIBDHYANA_API LatencyHistogram
+{
+public:
+    LatencyHistogram();
+
+    // must only be called while no thread is adding values
+    void reset();
+
+    //-- writer side
+    void add(double duration);
+
+    //-- reader side, durations in s
+    int    getCount() const;
+    double getPercentile(double percent) const;
+    double getMax() const;
+    // upper bound and count of each non empty bucket
+    void   getBuckets(std::vector<double>& bounds, std::vector<int>& counts) const;
+
+    static double getBucketBound(int bucket);
+
+private:
+    static int getBucket(double duration);
+
+    std::atomic<int>    m_counts[HISTOGRAM_NB_BUCKETS];
+    std::atomic<int>    m_count;
+    std::atomic<double> m_max;
+} ;
+
+} // namespace Dhyana
+} // namespace lima
+
+#endif /* DHYANAHISTOGRAM_H_ */
@@ -0,0 +1,97 @@
+//###########################################################################
+// This file is part of LImA, a Library for Image Acquisition
+//
+// Copyright (C) : 2009-2011
+// European Synchrotron Radiation Facility
+// BP 220, Grenoble 38043
+// FRANCE
+//
+// This is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This software is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//###########################################################################
+//
+// DhyanaPropertyCache.h
+// Created on: October 24, 2018
+// Author: Arafat NOUREDDINE
+
+#ifndef DHYANAPROPERTYCACHE_H_
+#define DHYANAPROPERTYCACHE_H_
+
+#include <map>
+#include "lima/Debug.h"
+#include "lima/ThreadUtils.h"
+#include "DhyanaCompatibility.h"
+#include "TUCamApi.h"
+#include "TUDefine.h"
+
+namespace lima
+{
+namespace Dhyana
+{
+
+/*******************************************************************
+ * \class PropertyCache
+ * \brief cache of the TUIDP_ properties, TUIDC_ capabilities and roi
+ *        read from TUCAM
+ *
+ * A value is read from TUCAM on the first get, then served from the
+ * cache. A set is written to TUCAM and invalidates the cached value
+ * rather than storing it (no write-through), so that the next get reads
+ * back the value really applied by the camera after its rounding. A set
+ * also invalidates the values that depend on it: a roi or a capability
+ * (e.g. the resolution) changes the readout, hence the limits of the
+ * properties such as the exposure, and a capability may reset the roi.
+ * TUCAM calls made outside of the cache that change the readout (e.g.
+ * the trigger mode) must be followed by invalidate().
+ * In verify mode every get also reads TUCAM and counts the mismatches.
+ * Values changed by the camera itself (e.g. the sensor temperature) must
+ * not be read through this cache.
+ *******************************************************************/
+class LIBDHYANA_API PropertyCache
+{
+    DEB_CLASS_NAMESPC(DebModCamera, "PropertyCache", "Dhyana");
+
+public:
+    PropertyCache();
+
+    void setHandle(HDTUCAM handle);
+    void invalidate();
+    void setVerify(bool verify);
+    bool getVerify() const;
+    void getStats(int& nb_hits, int& nb_misses, int& nb_mismatches) const;
+
+    // return the TUCAM status of the call
+    TUCAMRET getProp(int id, double& value);
+    TUCAMRET setProp(int id, double value);
+    TUCAMRET getCapa(int id, int& value);
+    TUCAMRET setCapa(int id, int value);
+    TUCAMRET getRoi(TUCAM_ROI_ATTR& roi);
+    TUCAMRET setRoi(const TUCAM_ROI_ATTR& roi);
+
+private:
+    HDTUCAM                 m_handle;
+    mutable Mutex           m_lock;
+    bool                    m_verify;
+    std::map<int, double>   m_props;
+    std::map<int, int>      m_capas;
+    bool                    m_roi_valid;
+    TUCAM_ROI_ATTR          m_roi;
+    int                     m_nb_hits;
+    int                     m_nb_misses;
+    int                     m_nb_mismatches;
+} ;
+
+} // namespace Dhyana
+} // namespace lima
+
+#endif /* DHYANAPROPERTYCACHE_H_ */
@@ -29,15 +29,21 @@
 
 
 #include <ostream>
-#include <map>
-#include <process.h>
-#include <windows.h>
+#include <vector>
 #include <stdio.h>
+#ifdef WIN32
+#include <windows.h>
 #include <Mmsystem.h>
 #pragma comment(lib, "Winmm.lib" )
+// not defined by SDKs older than Windows 10 1803
+#ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002
+#endif
+#endif
 
 #include "DhyanaCompatibility.h"
 #include "lima/Debug.h"
+#include "lima/ThreadUtils.h"
 #include "DhyanaCamera.h"
 
 using namespace std;
@@ -50,29 +56,40 @@ namespace lima
 
 		class Camera;
 
+		const double TIMER_STOP_POLL_TIME   = 0.010;  // (s) max delay to notice a stop() while sleeping
+		const double TIMER_SPIN_TIME        = 0.0002; // (s) busy wait before a deadline (high resolution timer)
+		const double TIMER_SPIN_TIME_LEGACY = 0.002;  // (s) busy wait before a deadline (1 ms timer)
+		const double TIMER_SPIN_TIME_MAX    = 0.005;  // (s) max busy wait accepted by setSpinTime()
+		const size_t TIMER_JITTER_HISTORY   = 100000; // max nb of jitter samples kept per run
+
 		/******************************************************************
+		* \class CBaseTimer
+		* \brief periodic timer thread sleeping until absolute deadlines
 		*
+		* The n-th tick is due at start + n * period on a monotonic clock,
+		* so late wake-ups never accumulate into a drift. Ticks that are
+		* already more than one period late are skipped, not burst.
 		*******************************************************************/
-		class CBaseTimer
+		class CBaseTimer : public Thread
 		{
 			DEB_CLASS_NAMESPC(DebModCamera, "Camera", "CBaseTimer");
 		public:
 			// ctor
 			//------------------------------------------------------------
-			CBaseTimer(int period = 1000);
+			CBaseTimer(double period = 1.);
 
 			// dtor
 			//------------------------------------------------------------
-			~CBaseTimer();
+			virtual ~CBaseTimer();
 
 			//------------------------------------------------------------
-			static void CALLBACK base_timer_proc(UINT uID, UINT uMsg, DWORD_PTR dwUser, DWORD_PTR dw1, DWORD_PTR dw2)
-			{
-				//std::cout<<" ----> base_timer_proc <------- [BEGIN]"<<std::endl;
-				CBaseTimer* pThis = (CBaseTimer*)dwUser;
-				pThis->on_timer();
-				//std::cout<<" ----> base_timer_proc <------- [END]"<<std::endl;
-			}
+			void setPeriod(double period);
+			double getPeriod() const;
+
+			//------------------------------------------------------------
+			// busy wait (s) before each deadline, 0 to never spin (Windows only)
+			void setSpinTime(double spin_time);
+			double getSpinTime() const;
 
 			//------------------------------------------------------------
 			void start();
@@ -83,15 +100,40 @@ namespace lima
 			//------------------------------------------------------------
 			virtual void on_timer() = 0;
 
+			//------------------------------------------------------------
+			// delay (s) between each deadline and the actual tick of the last run
+			void getJitter(std::vector<double>& jitter);
+			void getJitterStats(int& nb_ticks, int& nb_missed, double& mean_jitter, double& max_jitter);
+
+			//------------------------------------------------------------
+			static double now();
+
 		protected:
-			int  m_timer_id;
-			long m_period_ms;
-			UINT m_resolution;
-			int  m_nb_triggers;
+			virtual void threadFunction();
+
+			void sleepUntil(double deadline, bool precise);
+
+			mutable Cond m_cond;
+			bool   m_running;
+			bool   m_in_timer;
+			bool   m_quit;
+			int    m_run;      // incremented by each start(), a running tick loop restarts on change
+			double m_period;
+			int    m_nb_triggers;
+			int    m_nb_missed;
+			double m_jitter_sum;
+			double m_jitter_max;
+			std::vector<double> m_jitter;
+			double m_spin_time;
+#ifdef WIN32
+			HANDLE m_timer_handle;
+			bool   m_legacy_timer;
+#endif
 		};
 
 		/******************************************************************
-		*
+		* \class CSoftTriggerTimer
+		* \brief send a TUCAM software trigger on each tick
 		******************************************************************/
 		class CSoftTriggerTimer : public CBaseTimer
 		{
@@ -99,7 +141,7 @@ namespace lima
 		public:
 			//ctor
 			//------------------------------------------------------------
-			CSoftTriggerTimer(int period, Camera& cam);
+			CSoftTriggerTimer(double period, Camera& cam);
 
 			//dtor
 			//------------------------------------------------------------
@@ -112,6 +154,29 @@ namespace lima
 			Camera& m_cam;
 		};
 
+		/******************************************************************
+		* \class CWatchdogTimer
+		* \brief check on each tick that frames still come out of the camera
+		******************************************************************/
+		class CWatchdogTimer : public CBaseTimer
+		{
+			DEB_CLASS_NAMESPC(DebModCamera, "Camera", "CWatchdogTimer");
+		public:
+			//ctor
+			//------------------------------------------------------------
+			CWatchdogTimer(Camera& cam);
+
+			//dtor
+			//------------------------------------------------------------
+			~CWatchdogTimer();
+
+			//------------------------------------------------------------
+			void on_timer();
+
+		public:
+			Camera& m_cam;
+		};
+
 	} // namespace Dhyana
 } // namespace lima
 
@@ -0,0 +1,79 @@
+//###########################################################################
+// This file is part of LImA, a Library for Image Acquisition
+//
+// Copyright (C) : 2009-2011
+// European Synchrotron Radiation Facility
+// BP 220, Grenoble 38043
+// FRANCE
+//
+// This is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This software is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//###########################################################################
+//
+// DhyanaTopology.h
+// Created on: October 24, 2018
+// Author: Arafat NOUREDDINE
+
+#ifndef DHYANATOPOLOGY_H_
+#define DHYANATOPOLOGY_H_
+
+#include <vector>
+#include <string>
+#include "DhyanaCompatibility.h"
+
+namespace lima
+{
+namespace Dhyana
+{
+
+/*******************************************************************
+ * \class CpuTopology
+ * \brief NUMA nodes of the host and binding of threads to cpus
+ *
+ * Only the first processor group (64 cpus) is seen under Windows.
+ *******************************************************************/
+class LIBDHYANA_API CpuTopology
+{
+public:
+    /*******************************************************************
+     * \class CpuTopology::ScopedBinding
+     * \brief bind the calling thread to cpus until the end of the scope
+     *******************************************************************/
+    class ScopedBinding
+    {
+    public:
+        ScopedBinding(const std::vector<int>& cpus);
+        ~ScopedBinding();
+    private:
+        bool               m_bound;
+#ifdef WIN32
+        unsigned long long m_previous_mask;
+#else
+        std::vector<int>   m_previous_cpus;
+#endif
+    } ;
+
+    static int  getNbCpus();
+    static int  getNbNodes();
+    // cpus of a NUMA node, false if the node does not exist
+    static bool getNodeCpus(int node, std::vector<int>& cpus);
+    // restrict the calling thread to cpus
+    static bool bindCurrentThread(const std::vector<int>& cpus);
+    // "0-3,8" like list of cpus
+    static std::string toString(const std::vector<int>& cpus);
+} ;
+
+} // namespace Dhyana
+} // namespace lima
+
+#endif /* DHYANATOPOLOGY_H_ */
@@ -0,0 +1,564 @@
+//###########################################################################
+// This file is part of LImA, a Library for Image Acquisition
+//
+// Copyright (C) : 2009-2014
+// European Synchrotron Radiation Facility
+// BP 220, Grenoble 38043
+// FRANCE
+//
+// This is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This software is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//###########################################################################
+
+#include <string.h>
+#include <algorithm>
+#include "lima/Exceptions.h"
+#include "DhyanaBufferCtrlObj.h"
+#include "DhyanaTopology.h"
+
+#ifdef WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#include <sys/mman.h>
+#endif
+
+using namespace lima;
+using namespace lima::Dhyana;
+using namespace std;
+
+//---------------------------
+// @brief round size up to a multiple of alignment
+//---------------------------
+static size_t alignUp(size_t size, size_t alignment)
+{
+	return (size + alignment - 1) / alignment * alignment;
+}
+
+#ifdef WIN32
+//---------------------------
+// @brief large pages need the "Lock pages in memory" privilege to be enabled in the process token
+//---------------------------
+static bool enableLockMemoryPrivilege()
+{
+	HANDLE token;
+	if(!OpenProcessToken(GetCurrentProcess(), TOKEN_ADJUST_PRIVILEGES | TOKEN_QUERY, &token))
+		return false;
+	TOKEN_PRIVILEGES privileges;
+	privileges.PrivilegeCount = 1;
+	privileges.Privileges[0].Attributes = SE_PRIVILEGE_ENABLED;
+	bool enabled = LookupPrivilegeValue(NULL, SE_LOCK_MEMORY_NAME, &privileges.Privileges[0].Luid)
+				   && AdjustTokenPrivileges(token, FALSE, &privileges, 0, NULL, NULL)
+				   && GetLastError() == ERROR_SUCCESS;
+	CloseHandle(token);
+	return enabled;
+}
+#endif
+
+//---------------------------
+// @brief  Ctor
+//---------------------------
+LargePageAllocMgr::LargePageAllocMgr():
+m_nb_buffers(0),
+m_buffer_size(0),
+m_ring(NULL),
+m_ring_size(0),
+m_use_large_pages(true),
+m_numa_node(-1),
+m_shared(false),
+m_ring_shared(false),
+m_large_pages(false),
+m_locked(false),
+m_alloc_time(0.0)
+{
+	DEB_CONSTRUCTOR();
+}
+
+//---------------------------
+// @brief  Dtor
+//---------------------------
+LargePageAllocMgr::~LargePageAllocMgr()
+{
+	DEB_DESTRUCTOR();
+	releaseBuffers();
+}
+
+//---------------------------
+// @brief nb of buffers fitting in the part of the physical memory given to the ring
+//---------------------------
+int LargePageAllocMgr::getMaxNbBuffers(const FrameDim& frame_dim)
+{
+	DEB_MEMBER_FUNCT();
+	size_t buffer_size = alignUp(frame_dim.getMemSize(), BUFFER_ALIGNMENT);
+#ifdef WIN32
+	MEMORYSTATUSEX status;
+	status.dwLength = sizeof(status);
+	GlobalMemoryStatusEx(&status);
+	double max_size = min(status.ullTotalPhys * BUFFER_MAX_MEMORY_RATIO, (double) status.ullAvailVirtual + m_ring_size);
+#else
+	double max_size = (double) sysconf(_SC_PHYS_PAGES) * sysconf(_SC_PAGESIZE) * BUFFER_MAX_MEMORY_RATIO;
+#endif
+	int max_nb_buffers = (int) min(max_size / buffer_size, 1e9);
+	DEB_RETURN() << DEB_VAR1(max_nb_buffers);
+	return max_nb_buffers;
+}
+
+//---------------------------
+// @brief reserve, pre-fault and lock the ring, unless the same ring is already allocated
+//---------------------------
+void LargePageAllocMgr::allocBuffers(int nb_buffers, const FrameDim& frame_dim)
+{
+	DEB_MEMBER_FUNCT();
+	DEB_PARAM() << DEB_VAR2(nb_buffers, frame_dim);
+	if(m_ring && nb_buffers == m_nb_buffers && frame_dim == m_frame_dim && m_shared == m_ring_shared)
+	{
+		DEB_TRACE() << "Buffer ring already allocated";
+		return;
+	}
+	releaseBuffers();
+
+	Timestamp t0 = Timestamp::now();
+	m_buffer_size = alignUp(frame_dim.getMemSize(), BUFFER_ALIGNMENT);
+	size_t size = m_shared ? m_buffer_size : m_buffer_size * nb_buffers;
+	m_large_pages = m_use_large_pages && allocLargePages(size);
+	if(!m_large_pages && !allocPages(size))
+	{
+		THROW_HW_ERROR(Error) << "Unable to allocate " << nb_buffers << " buffers of " << m_buffer_size << " bytes !";
+	}
+	m_frame_dim = frame_dim;
+	m_nb_buffers = nb_buffers;
+	m_ring_shared = m_shared;
+
+	//the first frames of the acquisition must not pay the page faults,
+	//touched from the NUMA node they are meant for (first touch placement)
+	{
+		std::vector<int> node_cpus;
+		CpuTopology::getNodeCpus(m_numa_node, node_cpus);
+		CpuTopology::ScopedBinding binding(node_cpus);
+		prefault();
+	}
+	m_locked = lock();
+	if(!m_locked)
+	{
+		DEB_WARNING() << "Unable to lock the buffer ring in memory";
+	}
+
+	m_alloc_time = Timestamp::now() - t0;
+	DEB_TRACE() << "Buffer ring : " << nb_buffers << (m_ring_shared ? " shared" : "") << " buffers, " << m_ring_size / (1024 * 1024) << " MB"
+				<< ", NUMA node = " << m_numa_node
+				<< ", large pages = " << m_large_pages << ", locked = " << m_locked
+				<< ", allocated in " << (int) (m_alloc_time * 1000) << " (ms)";
+}
+
+//---------------------------
+//
+//---------------------------
+const FrameDim& LargePageAllocMgr::getFrameDim()
+{
+	return m_frame_dim;
+}
+
+//---------------------------
+//
+//---------------------------
+void LargePageAllocMgr::getNbBuffers(int& nb_buffers)
+{
+	nb_buffers = m_nb_buffers;
+}
+
+//---------------------------
+// @brief unlock and free the ring
+//---------------------------
+void LargePageAllocMgr::releaseBuffers()
+{
+	DEB_MEMBER_FUNCT();
+	if(NULL == m_ring)
+		return;
+#ifdef WIN32
+	if(m_locked)
+	{
+		VirtualUnlock(m_ring, m_ring_size);
+	}
+	VirtualFree(m_ring, 0, MEM_RELEASE);
+#else
+	if(m_locked)
+	{
+		munlock(m_ring, m_ring_size);
+	}
+	munmap(m_ring, m_ring_size);
+#endif
+	m_ring = NULL;
+	m_ring_size = 0;
+	m_nb_buffers = 0;
+	m_frame_dim = FrameDim();
+	m_locked = false;
+	m_large_pages = false;
+}
+
+//---------------------------
+//
+//---------------------------
+void* LargePageAllocMgr::getBufferPtr(int buffer_nb)
+{
+	return m_ring_shared ? m_ring : m_ring + (size_t) buffer_nb * m_buffer_size;
+}
+
+//---------------------------
+//
+//---------------------------
+void LargePageAllocMgr::setLargePages(bool enable)
+{
+	DEB_MEMBER_FUNCT();
+	DEB_PARAM() << DEB_VAR1(enable);
+	m_use_large_pages = enable;
+}
+
+//---------------------------
+//
+//---------------------------
+void LargePageAllocMgr::getLargePages(bool& enable)
+{
+	enable = m_use_large_pages;
+}
+
+//---------------------------
+//
+//---------------------------
+void LargePageAllocMgr::setNumaNode(int node)
+{
+	DEB_MEMBER_FUNCT();
+	DEB_PARAM() << DEB_VAR1(node);
+	m_numa_node = node;
+}
+
+//---------------------------
+//
+//---------------------------
+void LargePageAllocMgr::setShared(bool shared)
+{
+	DEB_MEMBER_FUNCT();
+	DEB_PARAM() << DEB_VAR1(shared);
+	m_shared = shared;
+}
+
+//---------------------------
+//
+//---------------------------
+bool LargePageAllocMgr::needsRealloc() const
+{
+	return m_ring && m_shared != m_ring_shared;
+}
+
+//---------------------------
+//
+//---------------------------
+void LargePageAllocMgr::getAllocStats(double& alloc_time, size_t& ring_size, bool& large_pages, bool& locked)
+{
+	alloc_time = m_alloc_time;
+	ring_size = m_ring_size;
+	large_pages = m_large_pages;
+	locked = m_locked;
+}
+
+//---------------------------
+// @brief ring made of large pages, which are never paged out
+//---------------------------
+bool LargePageAllocMgr::allocLargePages(size_t size)
+{
+	DEB_MEMBER_FUNCT();
+#ifdef WIN32
+	size_t page_size = GetLargePageMinimum();
+	if(page_size == 0 || !enableLockMemoryPrivilege())
+	{
+		DEB_TRACE() << "Large pages are not available (Lock pages in memory privilege needed)";
+		return false;
+	}
+	size_t ring_size = alignUp(size, page_size);
+	DWORD type = MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES;
+	m_ring = (char*) ((m_numa_node >= 0) ? VirtualAllocExNuma(GetCurrentProcess(), NULL, ring_size, type, PAGE_READWRITE, m_numa_node)
+										  : VirtualAlloc(NULL, ring_size, type, PAGE_READWRITE));
+#else
+	//1 GB pages for rings of several GB, then 2 MB pages
+	size_t page_size = (size >= ((size_t) 4 << 30)) ? ((size_t) 1 << 30) : ((size_t) 2 << 20);
+	size_t ring_size = alignUp(size, page_size);
+	int flags = MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB;
+#ifdef MAP_HUGE_SHIFT
+	flags |= ((page_size == ((size_t) 1 << 30)) ? 30 : 21) << MAP_HUGE_SHIFT;
+#endif
+	void* ring = mmap(NULL, ring_size, PROT_READ | PROT_WRITE, flags, -1, 0);
+	m_ring = (ring == MAP_FAILED) ? NULL : (char*) ring;
+#endif
+	if(NULL == m_ring)
+	{
+		DEB_TRACE() << "Unable to allocate " << ring_size << " bytes of large pages of " << page_size << " bytes";
+		return false;
+	}
+	m_ring_size = ring_size;
+	return true;
+}
+
+//---------------------------
+// @brief ring made of standard pages
+//---------------------------
+bool LargePageAllocMgr::allocPages(size_t size)
+{
+#ifdef WIN32
+	DWORD type = MEM_RESERVE | MEM_COMMIT;
+	m_ring = (char*) ((m_numa_node >= 0) ? VirtualAllocExNuma(GetCurrentProcess(), NULL, size, type, PAGE_READWRITE, m_numa_node)
+										  : VirtualAlloc(NULL, size, type, PAGE_READWRITE));
+#else
+	void* ring = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	m_ring = (ring == MAP_FAILED) ? NULL : (char*) ring;
+	if(NULL != m_ring)
+	{
+		//transparent huge pages if the kernel has them
+		madvise(m_ring, size, MADV_HUGEPAGE);
+	}
+#endif
+	m_ring_size = (NULL == m_ring) ? 0 : size;
+	return NULL != m_ring;
+}
+
+//---------------------------
+// @brief touch every page of the ring
+//---------------------------
+void LargePageAllocMgr::prefault()
+{
+	for(size_t offset = 0; offset < m_ring_size; offset += BUFFER_ALIGNMENT)
+	{
+		((volatile char*) m_ring)[offset] = 0;
+	}
+}
+
+//---------------------------
+// @brief keep the ring in physical memory
+//---------------------------
+bool LargePageAllocMgr::lock()
+{
+#ifdef WIN32
+	//large pages are not pageable
+	if(m_large_pages)
+		return true;
+	//VirtualLock is limited by the minimum working set of the process
+	SIZE_T min_size, max_size;
+	HANDLE process = GetCurrentProcess();
+	if(!GetProcessWorkingSetSize(process, &min_size, &max_size)
+	   || !SetProcessWorkingSetSize(process, min_size + m_ring_size, max(max_size, min_size + m_ring_size)))
+		return false;
+	return VirtualLock(m_ring, m_ring_size) != 0;
+#else
+	return mlock(m_ring, m_ring_size) == 0;
+#endif
+}
+
+//---------------------------
+// @brief  Ctor
+//---------------------------
+BufferCtrlObj::BufferCtrlObj():
+m_buffer_cb_mgr(m_alloc_mgr),
+m_mgr(m_buffer_cb_mgr),
+m_zero_copy(false),
+m_zero_copy_max_nb_buffers(0)
+{
+	DEB_CONSTRUCTOR();
+}
+
+//---------------------------
+// @brief  Dtor
+//---------------------------
+BufferCtrlObj::~BufferCtrlObj()
+{
+	DEB_DESTRUCTOR();
+}
+
+//---------------------------
+//
+//---------------------------
+void BufferCtrlObj::setFrameDim(const FrameDim& frame_dim)
+{
+	m_mgr.setFrameDim(frame_dim);
+}
+
+//---------------------------
+//
+//---------------------------
+void BufferCtrlObj::getFrameDim(FrameDim& frame_dim)
+{
+	m_mgr.getFrameDim(frame_dim);
+}
+
+//---------------------------
+//
+//---------------------------
+void BufferCtrlObj::setNbBuffers(int nb_buffers)
+{
+	m_mgr.setNbBuffers(nb_buffers);
+}
+
+//---------------------------
+//
+//---------------------------
+void BufferCtrlObj::getNbBuffers(int& nb_buffers)
+{
+	m_mgr.getNbBuffers(nb_buffers);
+}
+
+//---------------------------
+//
+//---------------------------
+void BufferCtrlObj::setNbConcatFrames(int nb_concat_frames)
+{
+	m_mgr.setNbConcatFrames(nb_concat_frames);
+}
+
+//---------------------------
+//
+//---------------------------
+void BufferCtrlObj::getNbConcatFrames(int& nb_concat_frames)
+{
+	m_mgr.getNbConcatFrames(nb_concat_frames);
+}
+
+//---------------------------
+//
+//---------------------------
+void BufferCtrlObj::getMaxNbBuffers(int& max_nb_buffers)
+{
+	m_mgr.getMaxNbBuffers(max_nb_buffers);
+	if(m_zero_copy)
+	{
+		max_nb_buffers = min(max_nb_buffers, m_zero_copy_max_nb_buffers);
+	}
+}
+
+//---------------------------
+//
+//---------------------------
+void *BufferCtrlObj::getBufferPtr(int buffer_nb, int concat_frame_nb)
+{
+	//a released TUCAM slot falls back to the shared frame
+	if(m_zero_copy && buffer_nb < (int) m_frame_ptrs.size() && m_frame_ptrs[buffer_nb])
+		return m_frame_ptrs[buffer_nb];
+	return m_mgr.getBufferPtr(buffer_nb, concat_frame_nb);
+}
+
+//---------------------------
+//
+//---------------------------
+void *BufferCtrlObj::getFramePtr(int acq_frame_nb)
+{
+	if(m_zero_copy && !m_frame_ptrs.empty() && m_frame_ptrs[acq_frame_nb % m_frame_ptrs.size()])
+		return m_frame_ptrs[acq_frame_nb % m_frame_ptrs.size()];
+	return m_mgr.getFramePtr(acq_frame_nb);
+}
+
+//---------------------------
+//
+//---------------------------
+void BufferCtrlObj::getStartTimestamp(Timestamp& start_ts)
+{
+	m_mgr.getStartTimestamp(start_ts);
+}
+
+//---------------------------
+//
+//---------------------------
+void BufferCtrlObj::getFrameInfo(int acq_frame_nb, HwFrameInfoType& info)
+{
+	m_mgr.getFrameInfo(acq_frame_nb, info);
+	if(m_zero_copy && !m_frame_ptrs.empty() && m_frame_ptrs[acq_frame_nb % m_frame_ptrs.size()])
+	{
+		info.frame_ptr = m_frame_ptrs[acq_frame_nb % m_frame_ptrs.size()];
+	}
+}
+
+//---------------------------
+//
+//---------------------------
+void BufferCtrlObj::registerFrameCallback(HwFrameCallback& frame_cb)
+{
+	m_mgr.registerFrameCallback(frame_cb);
+}
+
+//---------------------------
+//
+//---------------------------
+void BufferCtrlObj::unregisterFrameCallback(HwFrameCallback& frame_cb)
+{
+	m_mgr.unregisterFrameCallback(frame_cb);
+}
+
+//---------------------------
+//
+//---------------------------
+StdBufferCbMgr& BufferCtrlObj::getBuffer()
+{
+	return m_buffer_cb_mgr;
+}
+
+//---------------------------
+//
+//---------------------------
+LargePageAllocMgr& BufferCtrlObj::getAllocMgr()
+{
+	return m_alloc_mgr;
+}
+
+//---------------------------
+// @brief in zero-copy mode Lima gets at most max_nb_buffers buffers, all sharing a single allocated frame
+//---------------------------
+void BufferCtrlObj::setZeroCopy(bool enable, int max_nb_buffers)
+{
+	DEB_MEMBER_FUNCT();
+	DEB_PARAM() << DEB_VAR2(enable, max_nb_buffers);
+	m_zero_copy = enable;
+	m_zero_copy_max_nb_buffers = max_nb_buffers;
+	m_alloc_mgr.setShared(enable);
+}
+
+//---------------------------
+// @brief the buffers may have been allocated by Lima before the mode changed
+//---------------------------
+void BufferCtrlObj::prepareAlloc()
+{
+	DEB_MEMBER_FUNCT();
+	int nb_buffers;
+	m_mgr.getNbBuffers(nb_buffers);
+	if(m_alloc_mgr.needsRealloc())
+	{
+		FrameDim frame_dim;
+		m_mgr.getFrameDim(frame_dim);
+		DEB_TRACE() << "Reallocate the buffers for the " << (m_zero_copy ? "zero-copy" : "copy") << " mode";
+		m_alloc_mgr.allocBuffers(nb_buffers, frame_dim);
+	}
+	m_frame_ptrs.assign(m_zero_copy ? nb_buffers : 0, (void*) NULL);
+}
+
+//---------------------------
+//
+//---------------------------
+void BufferCtrlObj::setFramePtr(int acq_frame_nb, void* ptr)
+{
+	if(!m_frame_ptrs.empty())
+	{
+		m_frame_ptrs[acq_frame_nb % m_frame_ptrs.size()] = ptr;
+	}
+}
+
+//---------------------------
+//
+//---------------------------
+void BufferCtrlObj::clearFramePtrs()
+{
+	fill(m_frame_ptrs.begin(), m_frame_ptrs.end(), (void*) NULL);
+}
@@ -24,9 +24,11 @@
 #include <iostream>
 #include <string>
 #include <math.h>
+#include <stdio.h>
 //#include <chrono>
 #include <climits>
 #include <iomanip>
+#include <algorithm>
 #include <signal.h>
 #include <unistd.h>
 #include <errno.h>
@@ -34,6 +36,8 @@
 #include "lima/Debug.h"
 #include "lima/MiscUtils.h"
 #include "DhyanaTimer.h"
+#include "DhyanaCopyEngine.h"
+#include "DhyanaCopyKernel.h"
 #include "DhyanaCamera.h"
 
 using namespace lima;
@@ -43,27 +47,116 @@ using namespace std;
 //---------------------------
 // @brief  Ctor
 //---------------------------
-Camera::Camera(unsigned short timer_period_ms):
-m_depth(16),
+Camera::Camera(unsigned short timer_period_ms, int nb_copy_threads, int numa_node):
 m_trigger_mode(IntTrig),
-m_status(Ready),
+m_exp_time(0.0),
+m_lat_time(0.0),
+m_image_type(Bpp16),
+m_acq_state(kAcqIdle),
+m_quit(false),
 m_acq_frame_nb(0),
+m_depth(16),
+m_status(Ready),
+m_full_resolution(-1),
 m_temperature_target(0),
+m_watchdog_timeout(0.0),
+m_watchdog_timeout_used(0.0),
+m_frame_wait_start(0.0),
+m_watchdog_fired(false),
+m_nb_recoveries(0),
+m_nb_recovery_failures(0),
+m_frame_stall_factor(FRAME_STALL_FACTOR),
 m_timer_period_ms(timer_period_ms),
-m_fps(0.0),
+m_zero_copy(false),
+m_sdk_buffer_depth(0),
+m_sdk_buffer_depth_used(1),
+m_sdk_buffer_allocated(false),
+m_sdk_buffer_lent(false),
+m_sdk_buffer_max_usage(0),
+m_sdk_buffer_reuse(false),
+m_sdk_buffer_cycle_seen(false),
+m_copy_engine(NULL),
+m_numa_node(numa_node),
+m_dispatch_continue(true),
+m_nb_queue_stalls(0),
+m_acq_start_time(0.0),
+m_start_request(0),
+m_start_ack(0),
+m_fault_state(kAcqIdle),
+m_transition_start(0.0),
+m_keep_armed(false),
+m_prepare_rearmed(true),
+m_nb_arms(0),
+m_nb_arm_reuses(0),
+m_nb_armed_triggers(0),
+m_nb_armed_frames(0),
+m_nb_stale_frames(0),
+m_prepare_time(0.0),
+m_start_time(0.0),
+m_scan_armed(false),
+m_scan_nb_points(0),
+m_scan_frames_per_point(1),
+m_scan_points_released(0),
+m_scan_release_time(0.0),
+m_deferred_commit(false),
+m_staged_exp_time_set(false),
+m_staged_exp_time(0.0),
+m_staged_trig_mode_set(false),
+m_staged_trig_mode(IntTrig),
+m_staged_roi_set(false),
+m_applied_exp_time(-1.0),
+m_trig_mode_applied(false),
+m_commit_time(0.0),
+m_fill_dropped_frames(false),
+m_hw_index_valid(false),
+m_hw_index_expected(0),
+m_hw_frame_nb(0),
+m_nb_dropped_frames(0),
+m_nb_duplicated_frames(0),
+m_nb_stacked_frames(1),
+m_stack_fill(0),
+m_stack_timestamp(0.0),
+m_nb_sub_frames(0),
 m_tucam_trigger_mode(kTriggerStandard),
+m_int_trigger_mode(kIntTrigTimer),
+m_sequence_mode(true),
+m_capture_mode(TUCCM_TRIGGER_SOFTWARE),
 m_tucam_trigger_edge_mode(kEdgeRising)
 {
 
 	DEB_CONSTRUCTOR();	
 	//Init TUCAM	
 	init();		
+	//bind the acquisition to the NUMA node the camera is attached to
+	DEB_TRACE() << "NUMA nodes : " << CpuTopology::getNbNodes() << ", cpus : " << CpuTopology::getNbCpus();
+	if(m_numa_node >= 0)
+	{
+		if(!CpuTopology::getNodeCpus(m_numa_node, m_acq_cpus))
+		{
+			THROW_HW_ERROR(InvalidValue) << "Unknown NUMA node : " << DEB_VAR1(numa_node);
+		}
+		m_bufferCtrlObj.getAllocMgr().setNumaNode(m_numa_node);
+		DEB_TRACE() << "Acquisition bound to NUMA node " << m_numa_node << " (cpus " << CpuTopology::toString(m_acq_cpus) << ")";
+	}
 	//create the acquisition thread
 	DEB_TRACE() << "Create the acquisition thread";
 	m_acq_thread = new AcqThread(*this);
+	DEB_TRACE() << "Create the dispatch thread";
+	m_frame_ready_event = CreateEvent(NULL, FALSE, FALSE, NULL);
+	m_frame_free_event = CreateEvent(NULL, FALSE, FALSE, NULL);
+	m_scan_event = CreateEvent(NULL, FALSE, FALSE, NULL);
+	m_dispatch_thread = new DispatchThread(*this);
+	DEB_TRACE() << "Frame copy kernel : " << CopyKernel::getName();
+	if(nb_copy_threads > 0)
+	{
+		DEB_TRACE() << "Create the copy engine (" << nb_copy_threads << " threads)";
+		m_copy_engine = new CopyEngine(nb_copy_threads, m_acq_cpus);
+	}
 	DEB_TRACE() <<"Create the Internal Trigger Timer";
-	m_internal_trigger_timer = new CSoftTriggerTimer(m_timer_period_ms, *this);
+	m_internal_trigger_timer = new CSoftTriggerTimer(m_timer_period_ms / 1000., *this);
+	m_watchdog_timer = new CWatchdogTimer(*this);
 	m_acq_thread->start();
+	m_dispatch_thread->start();
 }
 
 //-----------------------------------------------------
@@ -72,6 +165,12 @@ m_tucam_trigger_edge_mode(kEdgeRising)
 Camera::~Camera()
 {
 	DEB_DESTRUCTOR();
+	// a capture may have been kept armed by the last acquisition
+	{
+		AutoMutex lock(m_cond.mutex());
+		disarm();
+		releaseReservation();
+	}
 	// Close camera
 	DEB_TRACE() << "Close TUCAM API ...";
 	TUCAM_Dev_Close(m_opCam.hIdxTUCam);
@@ -81,9 +180,18 @@ Camera::~Camera()
 	//delete the acquisition thread
 	DEB_TRACE() << "Delete the acquisition thread";
 	delete m_acq_thread;
+	//delete the dispatch thread
+	DEB_TRACE() << "Delete the dispatch thread";
+	delete m_dispatch_thread;
+	CloseHandle(m_frame_ready_event);
+	CloseHandle(m_frame_free_event);
+	CloseHandle(m_scan_event);
+	//delete the copy engine
+	delete m_copy_engine;
 	//delete the Internal Trigger Timer
 	DEB_TRACE() << "Delete the Internal Trigger Timer";
 	delete m_internal_trigger_timer;
+	delete m_watchdog_timer;
 }
 
 //-----------------------------------------------------
@@ -126,6 +234,9 @@ void Camera::init()
 	//initialize TUCAM Event used when Waiting for Frame
 	m_hThdEvent = NULL;
 
+	//TUCAM values are read once, then served from the cache
+	m_prop_cache.setHandle(m_opCam.hIdxTUCam);
+
 	m_tgroutAttr1.nTgrOutPort = 0;
 	m_tgroutAttr1.nTgrOutMode = TucamSignal::kSignalReadEnd;
 	m_tgroutAttr1.nEdgeMode = TucamSignalEdge::kSignalEdgeRising;
@@ -143,6 +254,76 @@ void Camera::init()
 	m_tgroutAttr3.nEdgeMode = TucamSignalEdge::kSignalEdgeRising;
 	m_tgroutAttr3.nDelayTm = 0;
 	m_tgroutAttr3.nWidth = 5000;
+
+	initBinModes();
+}
+
+//-----------------------------------------------------
+// @brief list the binned TUIDC_RESOLUTION modes, from their text ("1024x1024(2x2Bin)")
+//-----------------------------------------------------
+void Camera::initBinModes()
+{
+	DEB_MEMBER_FUNCT();
+	m_hw_bins.clear();
+	m_hw_bin_modes.clear();
+	m_full_resolution = -1;
+
+	TUCAM_CAPA_ATTR capaAttr;
+	capaAttr.idCapa = TUIDC_RESOLUTION;
+	if(TUCAMRET_SUCCESS != TUCAM_Capa_GetAttr(m_opCam.hIdxTUCam, &capaAttr))
+	{
+		DEB_WARNING() << "Unable to Read TUIDC_RESOLUTION from the camera, binning is done in software only !";
+		return;
+	}
+	int current = capaAttr.nValDft;
+	m_prop_cache.getCapa(TUIDC_RESOLUTION, current);
+
+	for(int mode = capaAttr.nValMin; mode <= capaAttr.nValMax; mode++)
+	{
+		char text[64] = {0};
+		TUCAM_VALUE_TEXT valText;
+		valText.nID = TUIDC_RESOLUTION;
+		valText.dbValue = mode;
+		valText.pText = text;
+		valText.nTextSize = sizeof(text);
+		int width = 0;
+		int height = 0;
+		if(TUCAMRET_SUCCESS != TUCAM_Capa_GetValueText(m_opCam.hIdxTUCam, &valText) ||
+		   2 != sscanf(text, "%dx%d", &width, &height) || width <= 0 || height <= 0 ||
+		   PIXEL_NB_WIDTH % width || PIXEL_NB_HEIGHT % height)
+		{
+			DEB_TRACE() << "Resolution mode " << mode << " (" << text << ") is not a binning mode";
+			continue;
+		}
+		Bin hw_bin(PIXEL_NB_WIDTH / width, PIXEL_NB_HEIGHT / height);
+		DEB_TRACE() << "Resolution mode " << mode << " (" << text << ") : " << DEB_VAR1(hw_bin);
+		if(hw_bin == Bin(1, 1))
+		{
+			//keep the current unbinned mode (the camera may have several, e.g. Normal and Enhance)
+			if(m_full_resolution < 0 || mode == current)
+				m_full_resolution = mode;
+		}
+		else if(find(m_hw_bins.begin(), m_hw_bins.end(), hw_bin) == m_hw_bins.end())
+		{
+			m_hw_bins.push_back(hw_bin);
+			m_hw_bin_modes.push_back(mode);
+		}
+	}
+
+	//start unbinned, as m_bin
+	if(m_full_resolution >= 0 && current != m_full_resolution)
+	{
+		if(TUCAMRET_SUCCESS != m_prop_cache.setCapa(TUIDC_RESOLUTION, m_full_resolution))
+		{
+			THROW_HW_ERROR(Error) << "Unable to Write TUIDC_RESOLUTION to the camera !";
+		}
+	}
+	if(m_full_resolution < 0)
+	{
+		m_hw_bins.clear();
+		m_hw_bin_modes.clear();
+	}
+	DEB_TRACE() << "Hardware binning modes : " << m_hw_bins.size();
 }
 
 //-----------------------------------------------------
@@ -152,8 +333,15 @@ void Camera::reset()
 {
 	DEB_MEMBER_FUNCT();
 	stopAcq();	
+	if(m_acq_state == kAcqFault)
+	{
+		THROW_HW_ERROR(Error) << "Unable to reset, the AcqThread is still blocked in the capture !";
+	}
 	//@BEGIN : other stuff on Driver/API
-	//...
+	AutoMutex lock(m_cond.mutex());
+	disarm();
+	releaseReservation();
+	m_prop_cache.invalidate();
 	//@END
 }
 
@@ -168,49 +356,167 @@ void Camera::prepareAcq()
 
 	//@BEGIN : Ensure that Acquisition is Started before return ...
 	DEB_TRACE() << "prepareAcq ...";
+	if(m_acq_state == kAcqFault)
+	{
+		THROW_HW_ERROR(Error) << "Camera is in fault, a reset is needed !";
+	}
+	if(m_acq_state != kAcqIdle && m_acq_state != kAcqArmed)
+	{
+		THROW_HW_ERROR(Error) << "Unable to prepare the acquisition while it is running !";
+	}
+	beginTransition();
+	commitConfig();
 	DEB_TRACE() << "Ensure that Acquisition is Started";
 	setStatus(Camera::Exposure, false);
+
+	if(m_scan_armed && m_nb_frames != m_scan_nb_points * m_scan_frames_per_point)
+	{
+		THROW_HW_ERROR(InvalidValue) << "Step scan of " << m_scan_nb_points << " x " << m_scan_frames_per_point
+									 << " frames does not match the number of frames : " << DEB_VAR1(m_nb_frames);
+	}
+	if(m_zero_copy && m_nb_stacked_frames > 1)
+	{
+		THROW_HW_ERROR(NotSupported) << "Zero-copy can not be used with stacked frames !";
+	}
+	if(m_zero_copy && isSoftBinning())
+	{
+		THROW_HW_ERROR(NotSupported) << "Zero-copy can not be used with software binning or Bpp32 !";
+	}
+	if(m_zero_copy && m_sdk_buffer_reuse)
+	{
+		THROW_HW_ERROR(NotSupported) << "Zero-copy can not be used, TUCAM reuses its frame buffers before the reservation wraps around !";
+	}
+
+	int capture_mode = TUCCM_TRIGGER_STANDARD;
+	if(m_trigger_mode == IntTrig && m_sequence_mode && !m_scan_armed && m_nb_frames * m_nb_stacked_frames != 1 && m_lat_time == 0)
+	{
+		// free running mode, the camera streams frames back to back without any trigger
+		capture_mode = TUCCM_SEQUENCE;
+	}
+	else if(m_trigger_mode == IntTrig)
+	{
+		// software trigger
+		capture_mode = TUCCM_TRIGGER_SOFTWARE;
+	}
+	else if(m_trigger_mode == ExtTrigMult)
+	{
+		// external trigger STANDARD (EXPOSURE SOFT)
+		capture_mode = TUCCM_TRIGGER_STANDARD;
+	}
+	else if(m_trigger_mode == ExtGate)
+	{
+		// external trigger STANDARD (EXPOSURE WIDTH)
+		capture_mode = TUCCM_TRIGGER_STANDARD;
+	}
+
+	//in zero-copy the reservation keeps every Lima buffer, plus a margin for the frames not yet given to Lima
+	m_bufferCtrlObj.prepareAlloc();
+	int sdk_buffer_depth = (m_sdk_buffer_depth > 0) ? m_sdk_buffer_depth : computeSdkBufferDepth();
+	if(m_zero_copy)
+	{
+		int nb_buffers;
+		m_bufferCtrlObj.getNbBuffers(nb_buffers);
+		if(nb_buffers > SDK_BUFFER_MAX_DEPTH - ZERO_COPY_SDK_MARGIN)
+		{
+			THROW_HW_ERROR(NotSupported) << "Zero-copy is limited to " << SDK_BUFFER_MAX_DEPTH - ZERO_COPY_SDK_MARGIN
+										 << " Lima buffers : " << DEB_VAR1(nb_buffers);
+		}
+		sdk_buffer_depth = nb_buffers + ZERO_COPY_SDK_MARGIN;
+	}
+
+	//a capture kept armed by the previous acquisition is only reused for the same capture mode and reservation
+	if(NULL != m_hThdEvent && (capture_mode != m_capture_mode || (m_zero_copy && sdk_buffer_depth != m_sdk_buffer_depth_used)))
+	{
+		disarm();
+	}
+
+	m_prepare_rearmed = (NULL == m_hThdEvent);
 	if(NULL == m_hThdEvent)
 	{
+		//a reservation kept for the frames of the previous zero-copy acquisition is not needed anymore
+		releaseReservation();
 		m_frame.pBuffer = NULL;
 		m_frame.ucFormatGet = TUFRM_FMT_RAW;
-		m_frame.uiRsdSize = 1;// how many frames do you want
+		m_sdk_buffer_depth_used = sdk_buffer_depth;
+		m_frame.uiRsdSize = m_sdk_buffer_depth_used;// how many frames do you want
+		DEB_TRACE() << "TUCAM frame reservation : " << m_sdk_buffer_depth_used << " frame(s)";
 
-		// Alloc buffer after set resolution or set ROI attribute
+		// Alloc buffer after set resolution or set ROI attribute, from the NUMA node of the acquisition
 		DEB_TRACE() << "TUCAM_Buf_Alloc";
-		TUCAM_Buf_Alloc(m_opCam.hIdxTUCam, &m_frame);
-
-		DEB_TRACE() << "TUCAM_Cap_Start";
-		if(m_trigger_mode == IntTrig)
+		TUCAMRET alloc_ret;
 		{
-			// Start capture in software trigger
-			TUCAM_Cap_Start(m_opCam.hIdxTUCam, TUCCM_TRIGGER_SOFTWARE);
+			CpuTopology::ScopedBinding binding(m_acq_cpus);
+			alloc_ret = TUCAM_Buf_Alloc(m_opCam.hIdxTUCam, &m_frame);
 		}
-		else if(m_trigger_mode == ExtTrigMult)
+		if(TUCAMRET_SUCCESS != alloc_ret)
 		{
-			// Start capture in external trigger STANDARD (EXPOSURE SOFT)
-			TUCAM_Cap_Start(m_opCam.hIdxTUCam, TUCCM_TRIGGER_STANDARD);
+			THROW_HW_ERROR(Error) << "Unable to allocate the TUCAM frame reservation of " << m_sdk_buffer_depth_used << " frame(s) !";
 		}
-		else if(m_trigger_mode == ExtGate)
+		m_sdk_buffer_allocated = true;
+		m_sdk_buffer_lent = m_zero_copy;
+
+		DEB_TRACE() << "TUCAM_Cap_Start";
+		DEB_TRACE() << "Capture mode : " << ((capture_mode == TUCCM_SEQUENCE) ? "TUCCM_SEQUENCE" :
+										   (capture_mode == TUCCM_TRIGGER_SOFTWARE) ? "TUCCM_TRIGGER_SOFTWARE" : "TUCCM_TRIGGER_STANDARD");
+		m_capture_mode = capture_mode;
+		if(TUCAMRET_SUCCESS != TUCAM_Cap_Start(m_opCam.hIdxTUCam, m_capture_mode))
 		{
-			// Start capture in external trigger STANDARD (EXPOSURE WIDTH)
-			TUCAM_Cap_Start(m_opCam.hIdxTUCam, TUCCM_TRIGGER_STANDARD);
+			//the capture is not armed, only its reservation has to be released
+			releaseReservation();
+			THROW_HW_ERROR(Error) << "Unable to start the TUCAM capture !";
 		}
+		m_nb_armed_triggers = 0;
+		m_nb_armed_frames = 0;
+		m_nb_stale_frames = 0;
+		m_sdk_buffer_cycle_seen = false;
+		m_nb_arms++;
 		
 		////DEB_TRACE() << "TUCAM CreateEvent";
 		m_hThdEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
 	}
+	else
+	{
+		//frames triggered during the previous acquisition may still come out of the reservation
+		m_nb_stale_frames = m_nb_armed_triggers - m_nb_armed_frames;
+		m_nb_arm_reuses++;
+		DEB_TRACE() << "Capture still armed, " << m_nb_stale_frames << " stale frame(s) will be skipped";
+	}
+
+	//a frame stays valid until the reservation wraps around, never queue more than that,
+	//nor more than one frame if TUCAM was seen reusing a buffer earlier
+	m_frame_queue.reset(m_sdk_buffer_reuse ? 1 : m_sdk_buffer_depth_used);
+	{
+		AutoMutex trigger_lock(m_trigger_times_lock);
+		m_trigger_times.clear();
+	}
 	
 	//@BEGIN : trigger the acquisition
-	if(m_trigger_mode == IntTrig)	
+	if(m_trigger_mode == IntTrig && m_capture_mode == TUCCM_SEQUENCE)
+	{
+		DEB_TRACE() << "No internal trigger needed in sequence mode";
+	}
+	else if(m_trigger_mode == IntTrig && m_scan_armed)
 	{
-		DEB_TRACE() <<"Start Internal Trigger Timer";
+		DEB_TRACE() << "Step scan : internal triggers are issued by the AcqThread on nextPoint()";
+	}
+	else if(m_trigger_mode == IntTrig && m_int_trigger_mode == kIntTrigOnFrame)
+	{
+		DEB_TRACE() << "Internal triggers are issued by the AcqThread on each frame";
+	}
+	else if(m_trigger_mode == IntTrig)	
+	{
+		//retrigger as soon as exposure and latency are over, but not faster than the configured period
+		double period = max(m_exp_time + m_lat_time, m_timer_period_ms / 1000.);
+		DEB_TRACE() <<"Start Internal Trigger Timer (period = " << period * 1000 << " ms)";
+		m_internal_trigger_timer->setPeriod(period);
 		m_internal_trigger_timer->start();
 	}
 	//@END
+	setAcqState(kAcqArmed);
 	
 	Timestamp t1 = Timestamp::now();
 	double delta_time = t1 - t0;
+	m_prepare_time = delta_time;
 	DEB_TRACE() << "prepareAcq : elapsed time = " << (int) (delta_time * 1000) << " (ms)";
 	//@END
 }
@@ -226,23 +532,49 @@ void Camera::startAcq()
 	Timestamp t0 = Timestamp::now();
 
 	DEB_TRACE() << "startAcq ...";
+	if(m_acq_state != kAcqArmed)
+	{
+		THROW_HW_ERROR(Error) << "Unable to start the acquisition, it is not prepared !";
+	}
 	m_acq_frame_nb = 0;
-	m_fps = 0.0;
+	m_sdk_buffer_max_usage = 0;
+	m_stack_fill = 0;
+	m_nb_sub_frames = 0;
+	if(m_nb_stacked_frames > 1)
+	{
+		int nb_sub_frames = m_nb_frames ? m_nb_frames * m_nb_stacked_frames : SUB_FRAME_HISTORY;
+		m_sub_frames.resize(min(nb_sub_frames, SUB_FRAME_HISTORY));
+	}
+	else
+	{
+		m_sub_frames.clear();
+	}
 	StdBufferCbMgr& buffer_mgr = m_bufferCtrlObj.getBuffer();
+	//frame timestamps are taken with the monotonic clock of the trigger scheduler, relative to this instant
+	m_acq_start_time = CBaseTimer::now();
 	buffer_mgr.setStartTimestamp(Timestamp::now());
 	
 	DEB_TRACE() << "Ensure that Acquisition is Started  & wait thread to be started";
 	setStatus(Camera::Exposure, false);		
-	//Start acquisition thread & wait 
+	//Start acquisition thread & wait, at most ACQ_START_TIMEOUT
+	beginTransition();
+	int start_request = ++m_start_request;
+	m_cond.broadcast();
+	double deadline = CBaseTimer::now() + ACQ_START_TIMEOUT;
+	//the AcqThread echoes the request : a short acquisition may already be over, and back to Armed if kept armed
+	while(m_start_ack != start_request && CBaseTimer::now() < deadline)
+	{
+		m_cond.wait(DISPATCH_POLL_MS / 1000.);
+	}
+	if(m_start_ack != start_request)
 	{
-		m_wait_flag = false;
-		m_quit = false;
-		m_cond.broadcast();
-		m_cond.wait();
+		setFault();
+		THROW_HW_ERROR(Error) << "AcqThread did not start within " << ACQ_START_TIMEOUT << " s !";
 	}
 	
 	Timestamp t1 = Timestamp::now();
 	double delta_time = t1 - t0;
+	m_start_time = delta_time;
 	DEB_TRACE() << "startAcq : elapsed time = " << (int) (delta_time * 1000) << " (ms)";
 }
 
@@ -254,920 +586,2632 @@ void Camera::stopAcq()
 	DEB_MEMBER_FUNCT();
 	AutoMutex aLock(m_cond.mutex());
 	DEB_TRACE() << "stopAcq ...";
-	// Don't do anything if acquisition is idle.
-	if(m_thread_running == true)
-	{
-		m_wait_flag = true;
-		m_cond.broadcast();		
-	}
 
 	//@BEGIN : Ensure that Acquisition is Stopped before return ...			
 	Timestamp t0 = Timestamp::now();
-	if(NULL != m_hThdEvent)
+	AcqState state = m_acq_state;
+	if(state == kAcqRunning)
 	{
-		DEB_TRACE() << "TUCAM_Buf_AbortWait";
-		TUCAM_Buf_AbortWait(m_opCam.hIdxTUCam);
-		WaitForSingleObject(m_hThdEvent, INFINITE);
-		CloseHandle(m_hThdEvent);
-		m_hThdEvent = NULL;
-		// Stop capture   
-		DEB_TRACE() << "TUCAM_Cap_Stop";
-		TUCAM_Cap_Stop(m_opCam.hIdxTUCam);
-		// Release alloc buffer after stop capture
-		DEB_TRACE() << "TUCAM_Buf_Release";
-		TUCAM_Buf_Release(m_opCam.hIdxTUCam);
+		//the AcqThread and the DispatchThread leave their loop as soon as they see the new state
+		beginTransition();
+		setAcqState(kAcqStopping);
+		if(m_trigger_mode == IntTrig)	
+		{
+			DEB_TRACE() <<"Stop Internal Trigger Timer";
+			m_internal_trigger_timer->stop();
+		}
+		m_watchdog_timer->stop();
+		if(!waitCaptureEnd(ACQ_STOP_TIMEOUT))
+		{
+			//the capture is left as it is, the TUCAM buffers may still be used by the AcqThread
+			setFault();
+			DEB_ERROR() << "AcqThread did not stop within " << ACQ_STOP_TIMEOUT << " s !";
+			return;
+		}
+		finishAcq();
+	}
+	else if(state == kAcqArmed)
+	{
+		//prepared but never started
+		beginTransition();
+		finishAcq();
+	}
+	else if(state == kAcqFault)
+	{
+		//the buffers can only be released once the AcqThread is out of the capture loop
+		if(m_fault_state != kAcqStopping || waitCaptureEnd(ACQ_STOP_TIMEOUT))
+		{
+			DEB_TRACE() << "Leave the fault state";
+			beginTransition();
+			if(m_trigger_mode == IntTrig)	
+			{
+				m_internal_trigger_timer->stop();
+			}
+			disarm();
+			m_scan_armed = false;
+			setAcqState(kAcqIdle);
+			setStatus(Camera::Ready, true);
+		}
 	}
 	//@END	
 	
-	//@BEGIN : trigger the acquisition
+	Timestamp t1 = Timestamp::now();
+	double delta_time = t1 - t0;
+	DEB_TRACE() << "stopAcq : elapsed time = " << (int) (delta_time * 1000) << " (ms)";		
+}
+
+//-----------------------------------------------------
+// @brief end of the acquisition once the AcqThread left the capture loop, with m_cond locked
+//-----------------------------------------------------
+void Camera::finishAcq()
+{
+	DEB_MEMBER_FUNCT();
 	if(m_trigger_mode == IntTrig)	
 	{
 		DEB_TRACE() <<"Stop Internal Trigger Timer";
 		m_internal_trigger_timer->stop();
 	}
-	//@END
-	
-	//@BEGIN
+	m_watchdog_timer->stop();
+
+	//a step scan is armed for one acquisition only
+	m_scan_armed = false;
+	if(NULL != m_hThdEvent && m_keep_armed && m_capture_mode == TUCCM_TRIGGER_SOFTWARE)
+	{
+		//no more trigger, leave the capture started for the next acquisition
+		ResetEvent(m_hThdEvent);
+		setAcqState(kAcqArmed);
+	}
+	else
+	{
+		disarm();
+		setAcqState(kAcqIdle);
+	}
+
 	//now detector is ready
 	DEB_TRACE() << "Ensure that Acquisition is Stopped";
 	setStatus(Camera::Ready, false);
-	//@END	
-	
-	Timestamp t1 = Timestamp::now();
-	double delta_time = t1 - t0;
-	DEB_TRACE() << "stopAcq : elapsed time = " << (int) (delta_time * 1000) << " (ms)";		
 }
 
 //-----------------------------------------------------
-// @brief set the new camera status
+// @brief abort TUCAM_Buf_WaitForFrame until the AcqThread left the capture loop, false once timeout (s) is over.
+// m_cond is locked and released while waiting, so that a capture recovery in progress can end
 //-----------------------------------------------------
-void Camera::setStatus(Camera::Status status, bool force)
+bool Camera::waitCaptureEnd(double timeout)
 {
 	DEB_MEMBER_FUNCT();
-	//AutoMutex aLock(m_cond.mutex());
-	if(force || m_status != Camera::Fault)
-		m_status = status;
-	//m_cond.broadcast();
+	if(NULL == m_hThdEvent)
+		return true;
+
+	double deadline = CBaseTimer::now() + timeout;
+	//the AcqThread may not be in TUCAM_Buf_WaitForFrame yet : abort until it is done
+	while(WAIT_TIMEOUT == WaitForSingleObject(m_hThdEvent, 0))
+	{
+		if(CBaseTimer::now() > deadline)
+			return false;
+		DEB_TRACE() << "TUCAM_Buf_AbortWait";
+		TUCAM_Buf_AbortWait(m_opCam.hIdxTUCam);
+		m_cond.wait(DISPATCH_POLL_MS / 1000.);
+	}
+	return true;
 }
 
 //-----------------------------------------------------
-//
+// @brief start timing a transition of the acquisition state
 //-----------------------------------------------------
-void Camera::getStatus(Camera::Status& status)
+void Camera::beginTransition()
 {
-	DEB_MEMBER_FUNCT();
-	AutoMutex aLock(m_cond.mutex());
-	status = m_status;
-
-	DEB_RETURN() << DEB_VAR1(status);
+	m_transition_start = CBaseTimer::now();
 }
 
 //-----------------------------------------------------
-//
+// @brief change the acquisition state, with m_cond locked
 //-----------------------------------------------------
-bool Camera::readFrame(void *bptr, int& frame_nb)
+void Camera::setAcqState(AcqState state)
 {
 	DEB_MEMBER_FUNCT();
-	Timestamp t0 = Timestamp::now();
-
-	//@BEGIN : Get frame from Driver/API & copy it into bptr already allocated 
-//	DEB_TRACE() << "Copy Buffer image into Lima Frame Ptr";
-	memcpy((unsigned short *) bptr, (unsigned short *) (m_frame.pBuffer + m_frame.usOffset), m_frame.uiImgSize);//we need a nb of BYTES .		
-	frame_nb = m_frame.uiIndex;
-	//@END	
+	static const char* state_names[kNbAcqStates] = {"Idle", "Armed", "Running", "Stopping", "Fault"};
+	AcqState previous = m_acq_state.exchange(state);
+	double latency = CBaseTimer::now() - m_transition_start;
+	m_transition_latency[state].add(latency);
+	DEB_TRACE() << "Acquisition state " << state_names[previous] << " -> " << state_names[state]
+				<< " (" << latency * 1000 << " ms)";
+}
 
-//	Timestamp t1 = Timestamp::now();
-//	double delta_time = t1 - t0;
-//	DEB_TRACE() << "readFrame : elapsed time = " << (int) (delta_time * 1000) << " (ms)";
-	return false;
+//-----------------------------------------------------
+// @brief a transition missed its deadline, only reset() leaves this state
+//-----------------------------------------------------
+void Camera::setFault()
+{
+	DEB_MEMBER_FUNCT();
+	m_fault_state = m_acq_state;
+	if(m_trigger_mode == IntTrig)	
+	{
+		m_internal_trigger_timer->stop();
+	}
+	m_watchdog_timer->stop();
+	setAcqState(kAcqFault);
+	setStatus(Camera::Fault, true);
 }
 
 //-----------------------------------------------------
-//
+// @brief write the staged parameters to TUCAM, skipping the unchanged ones
 //-----------------------------------------------------
-void Camera::AcqThread::threadFunction()
+void Camera::commitConfig()
 {
 	DEB_MEMBER_FUNCT();
-	AutoMutex aLock(m_cam.m_cond.mutex());
-	StdBufferCbMgr& buffer_mgr = m_cam.m_bufferCtrlObj.getBuffer();
+	if(!m_staged_roi_set && !m_staged_trig_mode_set && !m_staged_exp_time_set)
+		return;
 
-	while(!m_cam.m_quit)
+	Timestamp t0 = Timestamp::now();
+	m_commit_log.clear();
+
+	//the roi first : it changes the sensor readout, hence the exposure limits
+	if(m_staged_roi_set)
 	{
-		while(m_cam.m_wait_flag && !m_cam.m_quit)
+		m_staged_roi_set = false;
+		Roi hw_roi;
+		getRoi(hw_roi);
+		if(!(m_staged_roi == hw_roi))
 		{
-			DEB_TRACE() << "Wait for start acquisition ...";
-			m_cam.m_thread_running = false;
-			m_cam.m_cond.broadcast();
-			m_cam.m_cond.wait();
+			applyRoi(m_staged_roi);
+			std::ostringstream entry;
+			entry << "roi : " << hw_roi << " -> " << m_staged_roi;
+			m_commit_log.push_back(entry.str());
 		}
+	}
 
-		//if quit is requested (requested only by destructor)
-		if(m_cam.m_quit)
-			return;
-
-		DEB_TRACE() << "Running ...";
-		m_cam.m_thread_running = true;
-		m_cam.m_cond.broadcast();
-		aLock.unlock();		
-
-		Timestamp t0_capture = Timestamp::now();
-		Timestamp t0_fps, t1_fps, delta_fps;
-
-		//@BEGIN 
-		DEB_TRACE() << "Capture all frames ...";
-		bool continueFlag = true;
-		t0_fps = Timestamp::now();
-		while(continueFlag && (!m_cam.m_nb_frames || m_cam.m_acq_frame_nb < m_cam.m_nb_frames))
+	if(m_staged_trig_mode_set)
+	{
+		m_staged_trig_mode_set = false;
+		if(!m_trig_mode_applied || m_staged_trig_mode != m_trigger_mode)
 		{
-			// Check first if acq. has been stopped
-			if(m_cam.m_wait_flag)
-			{
-				DEB_TRACE() << "AcqThread has been stopped from user";
-				continueFlag = false;
-				continue;
-			}
-
-			//set status to exposure
-			m_cam.setStatus(Camera::Exposure, false);
-			
-			//wait frame from TUCAM API ...
-			if(m_cam.m_acq_frame_nb == 0)//display TRACE only once ...
-			{				
-				DEB_TRACE() << "TUCAM_Buf_WaitForFrame ...";
-			}
-			
-			if(TUCAMRET_SUCCESS == TUCAM_Buf_WaitForFrame(m_cam.m_opCam.hIdxTUCam, &m_cam.m_frame))
-			{
-				//The based information
-				//DEB_TRACE() << "m_cam.m_frame.szSignature = "	<< m_cam.m_frame.szSignature<<std::endl;		// [out]Copyright+Version: TU+1.0 ['T', 'U', '1', '\0']		
-				//DEB_TRACE() << "m_cam.m_frame.usHeader = "	<< m_cam.m_frame.usHeader<<std::endl;			// [out] The frame header size
-				//DEB_TRACE() << "m_cam.m_frame.usOffset = "	<< m_cam.m_frame.usOffset<<std::endl;			// [out] The frame data offset
-				//DEB_TRACE() << "m_cam.m_frame.usWidth = "		<< m_cam.m_frame.usWidth;						// [out] The frame width
-				//DEB_TRACE() << "m_cam.m_frame.usHeight = "	<< m_cam.m_frame.usHeight;						// [out] The frame height
-				//DEB_TRACE() << "m_cam.m_frame.uiWidthStep = "	<< m_cam.m_frame.uiWidthStep<<std::endl;		// [out] The frame width step
-				//DEB_TRACE() << "m_cam.m_frame.ucDepth = "		<< m_cam.m_frame.ucDepth<<std::endl;			// [out] The frame data depth 
-				//DEB_TRACE() << "m_cam.m_frame.ucFormat = "	<< m_cam.m_frame.ucFormat<<std::endl;			// [out] The frame data format                  
-				//DEB_TRACE() << "m_cam.m_frame.ucChannels = "	<< m_cam.m_frame.ucChannels<<std::endl;			// [out] The frame data channels
-				//DEB_TRACE() << "m_cam.m_frame.ucElemBytes = "	<< m_cam.m_frame.ucElemBytes<<std::endl;		// [out] The frame data bytes per element
-				//DEB_TRACE() << "m_cam.m_frame.ucFormatGet = "	<< m_cam.m_frame.ucFormatGet<<std::endl;		// [in]  Which frame data format do you want    see TUFRM_FORMATS
-				//DEB_TRACE() << "m_cam.m_frame.uiIndex = "		<< m_cam.m_frame.uiIndex;						// [in/out] The frame index number
-				//DEB_TRACE() << "m_cam.m_frame.uiImgSize = "	<< m_cam.m_frame.uiImgSize;						// [out] The frame size
-				//DEB_TRACE() << "m_cam.m_frame.uiRsdSize = "	<< m_cam.m_frame.uiRsdSize;						// [in]  The frame reserved size    (how many frames do you want)
-				//DEB_TRACE() << "m_cam.m_frame.uiHstSize = "	<< m_cam.m_frame.uiHstSize<<std::endl;			// [out] The frame histogram size	
-
-				// Grabbing was successful, process image
-				m_cam.setStatus(Camera::Readout, false);
-
-				//Prepare Lima Frame Ptr 
-				void* bptr = buffer_mgr.getFrameBufferPtr(m_cam.m_acq_frame_nb);
-
-				//Copy Frame into Lima Frame Ptr
-				int frame_nb = 0;
-				m_cam.readFrame(bptr, frame_nb);
-		
-				//Push the image buffer through Lima 
-				Timestamp t0 = Timestamp::now();
-				////DEB_TRACE() << "Declare a Lima new Frame Ready (" << m_cam.m_acq_frame_nb << ")";
-				HwFrameInfoType frame_info;
-				frame_info.acq_frame_nb = m_cam.m_acq_frame_nb;
-				continueFlag = buffer_mgr.newFrameReady(frame_info);
-				m_cam.m_acq_frame_nb++;
-				
-				Timestamp t1 = Timestamp::now();
-				double delta_time = t1 - t0;			
-
-				//wait latency after each frame , except for the last image 
-				if((!m_cam.m_nb_frames) || (m_cam.m_acq_frame_nb < m_cam.m_nb_frames) && (m_cam.m_lat_time))
-				{
-					////DEB_TRACE() << "Wait latency time : " << m_cam.m_lat_time * 1000 << " (ms) ...";
-					usleep((DWORD) (m_cam.m_lat_time * 1000000));
-				}				
-			}
-			else
-			{
-				DEB_TRACE() << "Unable to get the frame from the camera !";
-			}
-
-
-			t1_fps = Timestamp::now();
-			delta_fps = t1_fps - t0_fps;
-			if (delta_fps > 0)
-			{
-				m_cam.m_fps = m_cam.m_acq_frame_nb / delta_fps;
-			}
+			std::ostringstream entry;
+			entry << "trigger mode : " << m_trigger_mode << " -> " << m_staged_trig_mode;
+			applyTrigMode(m_staged_trig_mode);
+			m_commit_log.push_back(entry.str());
 		}
+	}
 
-		//
-		////DEB_TRACE() << "TUCAM SetEvent";
-		SetEvent(m_cam.m_hThdEvent);
-		//@END
-		
-		//stopAcq only if this is not already done		
-		DEB_TRACE() << "stopAcq only if this is not already done";
-		if(!m_cam.m_wait_flag)
+	if(m_staged_exp_time_set)
+	{
+		m_staged_exp_time_set = false;
+		if(m_staged_exp_time != m_applied_exp_time)
 		{
-			////DEB_TRACE() << "stopAcq";
-			m_cam.stopAcq();
+			std::ostringstream entry;
+			entry << "exposure time : " << m_exp_time << " -> " << m_staged_exp_time << " (s)";
+			applyExpTime(m_staged_exp_time);
+			m_commit_log.push_back(entry.str());
 		}
+	}
 
-		//now detector is ready
-		m_cam.setStatus(Camera::Ready, false);
-		DEB_TRACE() << "AcqThread is no more running";		
-		
-		Timestamp t1_capture = Timestamp::now();
-		double delta_time_capture = t1_capture - t0_capture;
-
-		DEB_TRACE() << "Capture all frames elapsed time = " << (int) (delta_time_capture * 1000) << " (ms)";				
-
-		aLock.lock();
-		m_cam.m_thread_running = false;
-		m_cam.m_wait_flag = true;
+	m_commit_time = Timestamp::now() - t0;
+	for(size_t i = 0; i < m_commit_log.size(); i++)
+	{
+		DEB_TRACE() << "commit " << m_commit_log[i];
 	}
+	DEB_TRACE() << "commitConfig : " << m_commit_log.size() << " value(s) written in " << m_commit_time * 1000 << " (ms)";
 }
 
 //-----------------------------------------------------
-//
+// @brief stop the TUCAM capture and release its frame reservation, with m_cond locked
+// in zero-copy the frames given to Lima still point into the reservation, it is kept
+// until the next prepareAcq or reset
 //-----------------------------------------------------
-Camera::AcqThread::AcqThread(Camera& cam):
-m_cam(cam)
+void Camera::disarm()
 {
-	AutoMutex aLock(m_cam.m_cond.mutex());
-	m_cam.m_wait_flag = true;
-	m_cam.m_quit = false;
-	aLock.unlock();
-	pthread_attr_setscope(&m_thread_attr, PTHREAD_SCOPE_PROCESS);
+	DEB_MEMBER_FUNCT();
+	if(NULL == m_hThdEvent)
+		return;
+
+	CloseHandle(m_hThdEvent);
+	m_hThdEvent = NULL;
+	// Stop capture   
+	DEB_TRACE() << "TUCAM_Cap_Stop";
+	TUCAM_Cap_Stop(m_opCam.hIdxTUCam);
+	if(!m_sdk_buffer_lent)
+		releaseReservation();
+}
+
+//-----------------------------------------------------
+// @brief release the TUCAM frame reservation of a stopped capture, with m_cond locked
+//-----------------------------------------------------
+void Camera::releaseReservation()
+{
+	DEB_MEMBER_FUNCT();
+	if(!m_sdk_buffer_allocated)
+		return;
+
+	//Lima must not get a pointer into the released memory anymore
+	if(m_sdk_buffer_lent)
+		m_bufferCtrlObj.clearFramePtrs();
+	// Release alloc buffer after stop capture
+	DEB_TRACE() << "TUCAM_Buf_Release";
+	TUCAM_Buf_Release(m_opCam.hIdxTUCam);
+	m_sdk_buffer_allocated = false;
+	m_sdk_buffer_lent = false;
+}
+
+//-----------------------------------------------------
+// @brief a parameter of the capture changed : release the armed capture, with m_cond locked
+//-----------------------------------------------------
+void Camera::disarmForChange()
+{
+	DEB_MEMBER_FUNCT();
+	AcqState state = m_acq_state;
+	if(state == kAcqRunning || state == kAcqStopping)
+	{
+		THROW_HW_ERROR(Error) << "Unable to change a parameter of the capture while the acquisition is running !";
+	}
+	//the AcqThread may still be in the capture, only stopAcq() can release it
+	if(state == kAcqFault)
+		return;
+
+	disarm();
+	//a prepared acquisition must be prepared again
+	if(state == kAcqArmed)
+	{
+		beginTransition();
+		if(m_trigger_mode == IntTrig)
+		{
+			m_internal_trigger_timer->stop();
+		}
+		setAcqState(kAcqIdle);
+	}
+}
+
+//-----------------------------------------------------
+// @brief set the new camera status
+//-----------------------------------------------------
+void Camera::setStatus(Camera::Status status, bool force)
+{
+	DEB_MEMBER_FUNCT();
+	//AutoMutex aLock(m_cond.mutex());
+	//a Fault is only left when forced, even if another thread sets the status meanwhile
+	Camera::Status current = m_status.load(std::memory_order_acquire);
+	do
+	{
+		if(!force && current == Camera::Fault)
+			return;
+	}
+	while(!m_status.compare_exchange_weak(current, status, std::memory_order_acq_rel, std::memory_order_acquire));
+	//m_cond.broadcast();
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void Camera::getStatus(Camera::Status& status)
+{
+	DEB_MEMBER_FUNCT();
+	//polled by Lima : never wait for prepareAcq/startAcq/stopAcq
+	status = m_status.load(std::memory_order_acquire);
+
+	DEB_RETURN() << DEB_VAR1(status);
+}
+
+//-----------------------------------------------------
+// @brief size the TUCAM reservation to absorb SDK_BUFFER_BURST_TIME of frames
+//-----------------------------------------------------
+int Camera::computeSdkBufferDepth()
+{
+	DEB_MEMBER_FUNCT();
+	Roi roi;
+	getRoi(roi);
+	double frame_size = (double) roi.getSize().getWidth() * roi.getSize().getHeight() * (m_depth / 8);
+	// a frame can not be delivered faster than 1 ms whatever the exposure
+	double frame_period = max(m_exp_time + m_lat_time, 0.001);
+
+	int depth = (int) ceil(SDK_BUFFER_BURST_TIME / frame_period);
+	if(frame_size > 0)
+	{
+		depth = min(depth, (int) (SDK_BUFFER_MAX_MEMORY / frame_size));
+	}
+	depth = max(SDK_BUFFER_MIN_DEPTH, min(depth, SDK_BUFFER_MAX_DEPTH));
+	DEB_RETURN() << DEB_VAR3(frame_size, frame_period, depth);
+	return depth;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+bool Camera::readFrame(const FrameQueue::Desc& frame, void *bptr, int& frame_nb)
+{
+	DEB_MEMBER_FUNCT();
+	double t0 = CBaseTimer::now();
+
+	//@BEGIN : Get frame from Driver/API & copy it into bptr already allocated 
+//	DEB_TRACE() << "Copy Buffer image into Lima Frame Ptr";
+	if(isSoftBinning())
+	{
+		//binning fused with the copy, the Lima frame is smaller than the TUCAM one
+		int dst_depth = (m_image_type == Bpp32) ? 32 : 16;
+		if(m_copy_engine)
+		{
+			m_copy_engine->bin(bptr, dst_depth, frame.ptr, frame.stride, frame.width, frame.height, m_soft_bin.getX(), m_soft_bin.getY());
+		}
+		else
+		{
+			CopyKernel::bin(bptr, dst_depth, frame.ptr, frame.stride, frame.width, frame.height, m_soft_bin.getX(), m_soft_bin.getY());
+		}
+	}
+	else if(m_copy_engine)
+	{
+		m_copy_engine->copy(bptr, frame.ptr, frame.stride, frame.size / frame.height, frame.height);
+	}
+	else
+	{
+		CopyKernel::copyRows(bptr, frame.ptr, frame.stride, frame.size / frame.height, frame.height);//we need a nb of BYTES .		
+	}
+	frame_nb = frame.index;
+	//@END	
+
+	m_latency[kStageCopy].add(CBaseTimer::now() - t0);
+	return false;
+}
+
+//-----------------------------------------------------
+// @brief frames are binned or widened to 32 bits on the copy
+//-----------------------------------------------------
+bool Camera::isSoftBinning() const
+{
+	return m_soft_bin.getX() > 1 || m_soft_bin.getY() > 1 || m_image_type == Bpp32;
+}
+
+//-----------------------------------------------------
+// @brief size of a TUCAM frame once copied in the Lima buffer
+//-----------------------------------------------------
+size_t Camera::getLimaFrameSize(const FrameQueue::Desc& frame) const
+{
+	if(!isSoftBinning())
+		return frame.size;
+	int depth = (m_image_type == Bpp32) ? 32 : 16;
+	return (size_t) (frame.width / m_soft_bin.getX()) * (frame.height / m_soft_bin.getY()) * (depth / 8);
+}
+
+//-----------------------------------------------------
+// @brief follow the TUCAM index sequence, return false for an already received frame
+//-----------------------------------------------------
+bool Camera::checkFrameIndex(unsigned hw_index, int& nb_missing)
+{
+	nb_missing = 0;
+	if(!m_hw_index_valid)
+	{
+		//first frame of the acquisition or of a restarted capture
+		m_hw_index_valid = true;
+		m_hw_index_expected = hw_index + 1;
+		m_hw_frame_nb++;
+		return true;
+	}
+
+	int delta = (int) (hw_index - m_hw_index_expected);
+	if(delta < 0)
+	{
+		m_nb_duplicated_frames++;
+		return false;
+	}
+
+	if(delta > 0)
+	{
+		nb_missing = delta;
+		m_nb_dropped_frames += delta;
+
+		FrameGap gap;
+		gap.hw_frame_nb = m_hw_frame_nb;
+		gap.hw_index = m_hw_index_expected;
+		gap.nb_frames = delta;
+		AutoMutex gaps_lock(m_frame_gaps_lock);
+		m_frame_gaps.push_back(gap);
+		m_hw_frame_nb += delta;
+	}
+	m_hw_index_expected = hw_index + 1;
+	m_hw_frame_nb++;
+	return true;
+}
+
+//-----------------------------------------------------
+// @brief give a frame to Lima and update the acquisition counters
+//-----------------------------------------------------
+void Camera::newFrameReady(StdBufferCbMgr& buffer_mgr, HwFrameInfoType& frame_info)
+{
+	////DEB_TRACE() << "Declare a Lima new Frame Ready (" << m_acq_frame_nb << ")";
+	double t0 = CBaseTimer::now();
+	m_dispatch_continue = buffer_mgr.newFrameReady(frame_info);
+	m_latency[kStageNewFrameReady].add(CBaseTimer::now() - t0);
+	//single writer : publish the new count once the frame is given to Lima
+	m_acq_frame_nb.store(m_acq_frame_nb.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+	//never give Lima more frames than requested, placeholders included
+	if(m_nb_frames && m_acq_frame_nb >= m_nb_frames)
+	{
+		m_dispatch_continue = false;
+	}
+	m_frame_rate.add(CBaseTimer::now());
+}
+
+//-----------------------------------------------------
+// @brief copy a TUCAM frame (or a blank one) in the current Lima frame, pushed to Lima once all its frames are stacked
+//-----------------------------------------------------
+void Camera::dispatchFrame(StdBufferCbMgr& buffer_mgr, const FrameQueue::Desc& frame, unsigned hw_index, bool blank)
+{
+	if(m_stack_fill == 0)
+	{
+		m_stack_timestamp = frame.timestamp;
+	}
+
+	HwFrameInfoType frame_info;
+	frame_info.acq_frame_nb = m_acq_frame_nb;
+	//time of arrival of the (first stacked) frame, rather than the time Lima receives it after the copy
+	frame_info.frame_timestamp = Timestamp(m_stack_timestamp - m_acq_start_time);
+	if(m_zero_copy && !blank)
+	{
+		//Lima Frame Ptr is the TUCAM reservation slot itself, nothing to copy
+		frame_info.frame_ptr = frame.ptr;
+		frame_info.buffer_owner_ship = HwFrameInfoType::Managed;
+		m_bufferCtrlObj.setFramePtr(m_acq_frame_nb, frame.ptr);
+	}
+	else
+	{
+		//Prepare Lima Frame Ptr, stacked frames are placed one under the other
+		size_t frame_size = getLimaFrameSize(frame);
+		unsigned char* bptr = (unsigned char*) buffer_mgr.getFrameBufferPtr(m_acq_frame_nb) + (size_t) m_stack_fill * frame_size;
+
+		//Copy Frame into Lima Frame Ptr
+		if(blank)
+		{
+			memset(bptr, 0, frame_size);
+			//in zero-copy the blank frames live in the shared Lima frame
+			m_bufferCtrlObj.setFramePtr(m_acq_frame_nb, bptr);
+		}
+		else
+		{
+			int frame_nb = 0;
+			readFrame(frame, bptr, frame_nb);
+		}
+	}
+
+	if(m_nb_stacked_frames > 1)
+	{
+		int sub_frame_nb = m_acq_frame_nb * m_nb_stacked_frames + m_stack_fill;
+		if(sub_frame_nb < (int) m_sub_frames.size())
+		{
+			SubFrame& sub_frame = m_sub_frames[sub_frame_nb];
+			sub_frame.hw_index = hw_index;
+			sub_frame.timestamp = frame.timestamp - m_acq_start_time;
+			sub_frame.blank = blank;
+			m_nb_sub_frames.store(sub_frame_nb + 1, std::memory_order_release);
+		}
+	}
+
+	if(++m_stack_fill < m_nb_stacked_frames)
+		return;
+	m_stack_fill = 0;
+
+	//Push the image buffer through Lima 
+	newFrameReady(buffer_mgr, frame_info);
+}
+
+//-----------------------------------------------------
+// @brief send one software trigger and keep the time it was sent
+//-----------------------------------------------------
+bool Camera::sendSoftwareTrigger()
+{
+	double trigger_time = CBaseTimer::now();
+	if(TUCAMRET_SUCCESS != TUCAM_Cap_DoSoftwareTrigger(m_opCam.hIdxTUCam))
+		return false;
+
+	m_nb_armed_triggers++;
+	AutoMutex trigger_lock(m_trigger_times_lock);
+	if((int) m_trigger_times.size() < TRIGGER_HISTORY)
+	{
+		m_trigger_times.push_back(trigger_time);
+	}
+	return true;
+}
+
+//-----------------------------------------------------
+// @brief wait frames from TUCAM and queue them to the DispatchThread
+//-----------------------------------------------------
+void Camera::AcqThread::threadFunction()
+{
+	DEB_MEMBER_FUNCT();
+	if(!m_cam.m_acq_cpus.empty() && !CpuTopology::bindCurrentThread(m_cam.m_acq_cpus))
+	{
+		DEB_WARNING() << "Unable to bind the AcqThread on NUMA node " << m_cam.m_numa_node;
+	}
+	AutoMutex aLock(m_cam.m_cond.mutex());
+	int start_request = m_cam.m_start_request;
+
+	while(!m_cam.m_quit)
+	{
+		while(start_request == m_cam.m_start_request && !m_cam.m_quit)
+		{
+			DEB_TRACE() << "Wait for start acquisition ...";
+			m_cam.m_cond.wait();
+		}
+
+		//if quit is requested (requested only by destructor)
+		if(m_cam.m_quit)
+			return;
+
+		//startAcq may have given up this request
+		start_request = m_cam.m_start_request;
+		if(m_cam.m_acq_state != kAcqArmed)
+		{
+			DEB_WARNING() << "Start request ignored, the acquisition is no more armed";
+			continue;
+		}
+
+		DEB_TRACE() << "Running ...";
+		m_cam.setAcqState(kAcqRunning);
+		m_cam.m_start_ack = start_request;
+		m_cam.m_dispatch_continue = true;
+		m_cam.m_nb_queue_stalls = 0;
+		//the stall detector compares with the trigger period when it is known
+		double expected_period = 0.0;
+		if(m_cam.m_trigger_mode == IntTrig && m_cam.m_capture_mode == TUCCM_TRIGGER_SOFTWARE && m_cam.m_int_trigger_mode == kIntTrigTimer)
+		{
+			//a Lima frame is given once all its TUCAM frames are received
+			expected_period = m_cam.m_internal_trigger_timer->getPeriod() * m_cam.m_nb_stacked_frames;
+		}
+		m_cam.m_frame_rate.reset(expected_period, m_cam.m_frame_stall_factor);
+		m_cam.m_hw_index_valid = false;
+		m_cam.m_hw_frame_nb = 0;
+		for(int i = 0; i < kNbLatencyStages; i++)
+		{
+			m_cam.m_latency[i].reset();
+		}
+		{
+			AutoMutex gaps_lock(m_cam.m_frame_gaps_lock);
+			m_cam.m_frame_gaps.clear();
+		}
+		m_cam.m_watchdog_timeout_used = m_cam.computeWatchdogTimeout();
+		m_cam.m_watchdog_fired = false;
+		m_cam.m_frame_wait_start = 0.0;
+		//started before stopAcq can see the Running state, so that its stop() is never overtaken
+		if(m_cam.m_watchdog_timeout_used > 0)
+		{
+			DEB_TRACE() << "Start the watchdog (timeout = " << m_cam.m_watchdog_timeout_used * 1000 << " ms)";
+			m_cam.m_watchdog_timer->setPeriod(m_cam.m_watchdog_timeout_used / WATCHDOG_NB_CHECKS);
+			m_cam.m_watchdog_timer->start();
+		}
+		m_cam.m_cond.broadcast();
+		aLock.unlock();		
+
+		Timestamp t0_capture = Timestamp::now();
+
+		//in kIntTrigOnFrame mode and in step scans the AcqThread issues every software trigger itself
+		bool scan = (m_cam.m_trigger_mode == IntTrig && m_cam.m_scan_armed);
+		//the frame counts below are in TUCAM frames
+		int nb_frames = m_cam.m_nb_frames * m_cam.m_nb_stacked_frames;
+		int frames_per_point = m_cam.m_scan_frames_per_point * m_cam.m_nb_stacked_frames;
+		bool trigger_on_frame = (m_cam.m_trigger_mode == IntTrig && m_cam.m_capture_mode == TUCCM_TRIGGER_SOFTWARE
+								 && (m_cam.m_int_trigger_mode == kIntTrigOnFrame || scan));
+		bool trigger_needed = trigger_on_frame;
+		//a trigger sent again for the same frame does not count as a new point
+		int last_timed_point = -1;
+
+		//a frame already pending in the TUCAM reservation is returned well before the frame period
+		double pending_time = max(m_cam.m_exp_time + m_cam.m_lat_time, 0.001) / 10;
+		int nb_pending = 0;
+		double last_frame_time = 0.0;
+		int nb_stale_frames = m_cam.m_nb_stale_frames;
+		bool capture_lost = false;
+
+		//TUCAM buffers of the last frames : a frame must not come in one of them before the reservation wraps around.
+		//Until a whole cycle of the reservation was seen, a reuse would only be detected once the frame is overwritten :
+		//frames are queued one at a time
+		int queue_capacity = m_cam.m_frame_queue.capacity();
+		int queue_limit = m_cam.m_sdk_buffer_cycle_seen ? queue_capacity : 1;
+		int nb_checked_buffers = 0;
+		std::vector<unsigned char*> recent_buffers(max(queue_capacity - 1, 0), (unsigned char*) NULL);
+		size_t recent_pos = 0;
+
+		//@BEGIN 
+		DEB_TRACE() << "Capture all frames ...";
+		int nb_waited_frames = 0;
+		while(m_cam.m_dispatch_continue && (!nb_frames || nb_waited_frames < nb_frames))
+		{
+			// Check first if acq. has been stopped
+			if(m_cam.m_acq_state != kAcqRunning)
+			{
+				DEB_TRACE() << "AcqThread has been stopped from user";
+				break;
+			}
+
+			//the next TUCAM_Buf_WaitForFrame may recycle the oldest frame of the reservation :
+			//wait until the DispatchThread is done with it
+			if(m_cam.m_frame_queue.size() >= queue_limit)
+			{
+				m_cam.m_nb_queue_stalls++;
+				while(m_cam.m_frame_queue.size() >= queue_limit && m_cam.m_acq_state == kAcqRunning)
+				{
+					WaitForSingleObject(m_cam.m_frame_free_event, DISPATCH_POLL_MS);
+				}
+				continue;
+			}
+
+			//in a step scan the frames of a point are only triggered once nextPoint() released it
+			if(scan && trigger_needed && nb_waited_frames >= m_cam.m_scan_points_released.load() * frames_per_point)
+			{
+				WaitForSingleObject(m_cam.m_scan_event, DISPATCH_POLL_MS);
+				continue;
+			}
+			if(scan && trigger_needed && nb_waited_frames % frames_per_point == 0 && nb_waited_frames / frames_per_point != last_timed_point)
+			{
+				last_timed_point = nb_waited_frames / frames_per_point;
+				m_cam.m_scan_dead_time.add(CBaseTimer::now() - m_cam.m_scan_release_time.load());
+			}
+
+			//the frame to come has a free slot in the queue, trigger it now
+			if(trigger_needed)
+			{
+				if(!m_cam.sendSoftwareTrigger())
+				{
+					DEB_TRACE() << "Unable to send the software trigger !";
+				}
+				trigger_needed = false;
+			}
+
+			//set status to exposure
+			m_cam.setStatus(Camera::Exposure, false);
+			
+			//wait frame from TUCAM API ...
+			if(nb_waited_frames == 0)//display TRACE only once ...
+			{				
+				DEB_TRACE() << "TUCAM_Buf_WaitForFrame ...";
+			}
+			
+			double t0_wait = CBaseTimer::now();
+			m_cam.m_frame_wait_start = t0_wait;
+			TUCAMRET wait_ret = TUCAM_Buf_WaitForFrame(m_cam.m_opCam.hIdxTUCam, &m_cam.m_frame);
+			m_cam.m_frame_wait_start = 0.0;
+			if(TUCAMRET_SUCCESS == wait_ret)
+			{
+				double frame_time = CBaseTimer::now();
+				m_cam.m_nb_armed_frames++;
+
+				//the queue relies on TUCAM returning each frame in its own buffer of the reservation
+				unsigned char* buffer = m_cam.m_frame.pBuffer;
+				if(!recent_buffers.empty())
+				{
+					if(find(recent_buffers.begin(), recent_buffers.end(), buffer) != recent_buffers.end())
+					{
+						m_cam.m_sdk_buffer_reuse = true;
+						if(m_cam.m_zero_copy)
+						{
+							DEB_ERROR() << "TUCAM reuses its frame buffers, zero-copy frames given to Lima are overwritten !";
+							capture_lost = true;
+							break;
+						}
+						DEB_WARNING() << "TUCAM reuses its frame buffers, frames are now copied one at a time";
+						queue_limit = 1;
+						recent_buffers.clear();
+					}
+					else
+					{
+						recent_buffers[recent_pos++ % recent_buffers.size()] = buffer;
+						if(queue_limit < queue_capacity && ++nb_checked_buffers >= m_cam.m_sdk_buffer_depth_used)
+						{
+							DEB_TRACE() << "TUCAM reservation cycle checked, up to " << queue_capacity << " frame(s) queued";
+							m_cam.m_sdk_buffer_cycle_seen = true;
+							queue_limit = queue_capacity;
+						}
+					}
+				}
+				if(nb_stale_frames > 0)
+				{
+					//triggered by the previous acquisition
+					nb_stale_frames--;
+					continue;
+				}
+				m_cam.m_latency[kStageWaitFrame].add(frame_time - t0_wait);
+				if(nb_waited_frames)
+				{
+					m_cam.m_latency[kStageFramePeriod].add(frame_time - last_frame_time);
+				}
+				last_frame_time = frame_time;
+
+				//track the backlog of frames waiting in the TUCAM reservation
+				double wait_time = frame_time - t0_wait;
+				nb_pending = (nb_waited_frames && wait_time < pending_time) ? nb_pending + 1 : 0;
+				if(nb_pending + 1 > m_cam.m_sdk_buffer_max_usage)
+				{
+					m_cam.m_sdk_buffer_max_usage = nb_pending + 1;
+				}
+
+				//a duplicated hardware frame is not given twice to Lima
+				int nb_missing = 0;
+				if(!m_cam.checkFrameIndex(m_cam.m_frame.uiIndex, nb_missing))
+				{
+					continue;
+				}
+
+				// Grabbing was successful, queue the frame for the DispatchThread
+				m_cam.setStatus(Camera::Readout, false);
+
+				//the rows of the TUCAM frame may be padded, the Lima frames are not
+				unsigned elem_bytes = m_cam.m_frame.ucElemBytes ? m_cam.m_frame.ucElemBytes : (unsigned) (m_cam.m_depth / 8);
+				unsigned row_size = m_cam.m_frame.usWidth * elem_bytes;
+				FrameQueue::Desc frame;
+				frame.ptr = m_cam.m_frame.pBuffer + m_cam.m_frame.usOffset;
+				frame.size = row_size * m_cam.m_frame.usHeight;
+				frame.index = m_cam.m_frame.uiIndex;
+				frame.width = m_cam.m_frame.usWidth;
+				frame.height = m_cam.m_frame.usHeight;
+				frame.stride = max((unsigned) m_cam.m_frame.uiWidthStep, row_size);
+				if(m_cam.m_zero_copy && frame.stride != row_size)
+				{
+					DEB_ERROR() << "TUCAM frame rows are padded (" << frame.stride << " bytes for " << row_size
+								<< "), they can not be given to Lima without a copy !";
+					capture_lost = true;
+					break;
+				}
+				frame.nb_missing = nb_missing;
+				frame.timestamp = frame_time;
+				m_cam.m_frame_queue.push(frame);
+				SetEvent(m_cam.m_frame_ready_event);
+				nb_waited_frames++;
+				if(m_cam.m_fill_dropped_frames)
+				{
+					//the placeholders count as acquired frames
+					nb_waited_frames += nb_missing;
+				}
+				trigger_needed = trigger_on_frame && (!nb_frames || nb_waited_frames < nb_frames);
+
+				//wait latency after each frame , except for the last image 
+				if((!nb_frames) || (nb_waited_frames < nb_frames) && (m_cam.m_lat_time))
+				{
+					////DEB_TRACE() << "Wait latency time : " << m_cam.m_lat_time * 1000 << " (ms) ...";
+					usleep((DWORD) (m_cam.m_lat_time * 1000000));
+				}				
+			}
+			else if(m_cam.m_watchdog_fired)
+			{
+				//no frame within the watchdog timeout : restart the capture, the frames acquired so far are kept
+				if(!m_cam.recoverCapture())
+				{
+					capture_lost = true;
+					break;
+				}
+				nb_stale_frames = 0;
+				nb_pending = 0;
+				trigger_needed = trigger_on_frame;
+				//the reservation is a new one, its cycle is checked again
+				fill(recent_buffers.begin(), recent_buffers.end(), (unsigned char*) NULL);
+				m_cam.m_sdk_buffer_cycle_seen = false;
+				queue_limit = 1;
+				nb_checked_buffers = 0;
+			}
+			else
+			{
+				DEB_TRACE() << "Unable to get the frame from the camera !";
+				//the trigger may have been lost, send it again
+				trigger_needed = trigger_on_frame;
+			}
+		}
+
+		//TUCAM buffers can only be released once the DispatchThread is done with them
+		while(m_cam.m_frame_queue.size() > 0)
+		{
+			WaitForSingleObject(m_cam.m_frame_free_event, DISPATCH_POLL_MS);
+		}
+
+		//no more frames : the frame rate and the stalls are now the ones at the last frame
+		m_cam.m_frame_rate.stop();
+
+		//
+		////DEB_TRACE() << "TUCAM SetEvent";
+		SetEvent(m_cam.m_hThdEvent);
+		//@END
+		
+		//the acquisition ended by itself (all frames acquired or refused by Lima) : end it here,
+		//otherwise stopAcq is ending it and is only waiting for the event above
+		aLock.lock();
+		if(m_cam.m_acq_state == kAcqRunning)
+		{
+			DEB_TRACE() << "End of the acquisition";
+			m_cam.beginTransition();
+			if(capture_lost)
+			{
+				m_cam.setFault();
+			}
+			else
+			{
+				m_cam.setAcqState(kAcqStopping);
+				m_cam.finishAcq();
+			}
+		}
+		m_cam.m_cond.broadcast();
+		aLock.unlock();
+		DEB_TRACE() << "AcqThread is no more running";		
+		
+		Timestamp t1_capture = Timestamp::now();
+		double delta_time_capture = t1_capture - t0_capture;
+
+		DEB_TRACE() << "Capture all frames elapsed time = " << (int) (delta_time_capture * 1000) << " (ms)";
+		DEB_TRACE() << "Sustained fps = " << m_cam.m_frame_rate.getAverageRate()
+					<< ", min over " << FRAME_RATE_WINDOW << " s = " << m_cam.m_frame_rate.getMinWindowRate()
+					<< ", stalls = " << m_cam.m_frame_rate.getNbStalls(CBaseTimer::now())
+					<< " (" << ((m_cam.m_capture_mode == TUCCM_SEQUENCE) ? "TUCCM_SEQUENCE" :
+								(m_cam.m_capture_mode == TUCCM_TRIGGER_SOFTWARE) ? "TUCCM_TRIGGER_SOFTWARE" : "TUCCM_TRIGGER_STANDARD") << ")";				
+		DEB_TRACE() << "TUCAM reservation max usage = " << m_cam.m_sdk_buffer_max_usage << " / " << m_cam.m_sdk_buffer_depth_used;
+		DEB_TRACE() << "Frame queue high water mark = " << m_cam.m_frame_queue.getHighWaterMark()
+					<< " / " << m_cam.m_frame_queue.capacity()
+					<< ", stalls = " << m_cam.m_nb_queue_stalls;
+		DEB_TRACE() << "Watchdog recoveries = " << m_cam.m_nb_recoveries << ", failures = " << m_cam.m_nb_recovery_failures;
+		DEB_TRACE() << "Dropped frames = " << m_cam.m_nb_dropped_frames
+					<< ", duplicated frames = " << m_cam.m_nb_duplicated_frames
+					<< " (" << m_cam.m_frame_gaps.size() << " gap(s) in this acquisition)";
+		static const char* stage_names[kNbLatencyStages] = {"WaitForFrame", "Copy", "newFrameReady", "Frame period"};
+		for(int i = 0; i < kNbLatencyStages; i++)
+		{
+			DEB_TRACE() << stage_names[i] << " (ms) : p50 = " << m_cam.m_latency[i].getPercentile(50) * 1000
+						<< ", p99 = " << m_cam.m_latency[i].getPercentile(99) * 1000
+						<< ", max = " << m_cam.m_latency[i].getMax() * 1000
+						<< " (" << m_cam.m_latency[i].getCount() << " samples)";
+		}
+
+		aLock.lock();
+	}
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+Camera::AcqThread::AcqThread(Camera& cam):
+m_cam(cam)
+{
+	AutoMutex aLock(m_cam.m_cond.mutex());
+	m_cam.m_quit = false;
+	aLock.unlock();
+	pthread_attr_setscope(&m_thread_attr, PTHREAD_SCOPE_PROCESS);
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+Camera::AcqThread::~AcqThread()
+{
+	AutoMutex aLock(m_cam.m_cond.mutex());
+	m_cam.m_quit = true;
+	m_cam.m_cond.broadcast();
+	aLock.unlock();
+	join();
+}
+
+//-----------------------------------------------------
+// @brief copy the queued frames and push them to Lima
+//-----------------------------------------------------
+void Camera::DispatchThread::threadFunction()
+{
+	DEB_MEMBER_FUNCT();
+	if(!m_cam.m_acq_cpus.empty() && !CpuTopology::bindCurrentThread(m_cam.m_acq_cpus))
+	{
+		DEB_WARNING() << "Unable to bind the DispatchThread on NUMA node " << m_cam.m_numa_node;
+	}
+	StdBufferCbMgr& buffer_mgr = m_cam.m_bufferCtrlObj.getBuffer();
+	FrameQueue::Desc frame;
+
+	while(!m_cam.m_quit)
+	{
+		if(!m_cam.m_frame_queue.front(frame))
+		{
+			WaitForSingleObject(m_cam.m_frame_ready_event, DISPATCH_POLL_MS);
+			continue;
+		}
+
+		//frames still queued when the acquisition is stopped are dropped
+		if(m_cam.m_acq_state == kAcqRunning && m_cam.m_dispatch_continue)
+		{
+			//keep Lima frame numbers aligned with the hardware ones
+			for(int i = 0; m_cam.m_fill_dropped_frames && i < frame.nb_missing && m_cam.m_dispatch_continue; i++)
+			{
+				m_cam.dispatchFrame(buffer_mgr, frame, frame.index - frame.nb_missing + i, true);
+			}
+
+			if(m_cam.m_dispatch_continue)
+			{
+				m_cam.dispatchFrame(buffer_mgr, frame, frame.index, false);
+			}
+		}
+
+		//give the TUCAM frame back to the AcqThread
+		m_cam.m_frame_queue.pop();
+		SetEvent(m_cam.m_frame_free_event);
+	}
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+Camera::DispatchThread::DispatchThread(Camera& cam):
+m_cam(cam)
+{
+	pthread_attr_setscope(&m_thread_attr, PTHREAD_SCOPE_PROCESS);
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+Camera::DispatchThread::~DispatchThread()
+{
+	m_cam.m_quit = true;
+	SetEvent(m_cam.m_frame_ready_event);
+	join();
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void Camera::getImageType(ImageType& type)
+{
+	DEB_MEMBER_FUNCT();
+	//@BEGIN : Fix the image type (pixel depth) into Driver/API		
+	switch(m_depth)
+	{
+		case 16: type = m_image_type;
+			break;
+		default:
+			THROW_HW_ERROR(Error) << "This pixel format of the camera is not managed, only 16 bits cameras are already managed!";
+			break;
+	}
+	//@END	
+	return;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void Camera::setImageType(ImageType type)
+{
+	DEB_MEMBER_FUNCT();
+	DEB_TRACE() << "setImageType - " << DEB_VAR1(type);
+	//@BEGIN : Fix the image type (pixel depth) into Driver/API	
+	long depth = m_depth;
+	switch(type)
+	{
+		case Bpp16:
+		case Bpp32: //16 bits pixels, summed into 32 bits by the software binning
+			depth = 16;
+			break;
+		default:
+			THROW_HW_ERROR(Error) << "This pixel format of the camera is not managed, only Bpp16 and Bpp32 are managed!";
+			break;
+	}
+	if(depth != m_depth)
+	{
+		AutoMutex lock(m_cond.mutex());
+		disarmForChange();
+	}
+	m_depth = depth;
+	//@END	
+
+	bool changed = (type != m_image_type);
+	if(changed && m_acq_state == kAcqRunning)
+	{
+		THROW_HW_ERROR(Error) << "Unable to change the image type while acquisition is running !";
+	}
+	m_image_type = type;
+
+	if(changed)
+	{
+		Size size;
+		getMaxImageSize(size);
+		maxImageSizeChanged(size, type);
+	}
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void Camera::getDetectorType(std::string& type)
+{
+	DEB_MEMBER_FUNCT();
+	//@BEGIN : Get Detector type from Driver/API
+	type = "Tucsen - Dhyana";
+	//@END	
+
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void Camera::getDetectorModel(std::string& model)
+{
+	DEB_MEMBER_FUNCT();
+	//@BEGIN : Get Detector model/type from Driver/API
+	stringstream ss;
+	TUCAM_VALUE_INFO valInfo;
+	valInfo.nID = TUIDI_CAMERA_MODEL;
+	if(TUCAMRET_SUCCESS != TUCAM_Dev_GetInfo(m_opCam.hIdxTUCam, &valInfo))
+	{
+		THROW_HW_ERROR(Error) << "Unable to Read TUIDI_CAMERA_MODEL from the camera !";
+	}
+	ss << valInfo.pText;
+	model = ss.str();
+	//@END		
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void Camera::getDetectorImageSize(Size& size)
+{
+	DEB_MEMBER_FUNCT();
+
+	//@BEGIN : Get Detector size in pixels from Driver/API
+	size = Size(PIXEL_NB_WIDTH, PIXEL_NB_HEIGHT);
+	//@END
+}
+
+//-----------------------------------------------------
+// @brief size of the Lima image, stacked frames included
+//-----------------------------------------------------
+void Camera::getMaxImageSize(Size& size)
+{
+	DEB_MEMBER_FUNCT();
+	size = Size(PIXEL_NB_WIDTH, PIXEL_NB_HEIGHT * m_nb_stacked_frames);
+	DEB_RETURN() << DEB_VAR1(size);
+}
+
+//-----------------------------------------------------
+// @brief size of the Lima image for the current hw roi, binning and stacked frames included
+//-----------------------------------------------------
+void Camera::getImageSize(Size& size)
+{
+	DEB_MEMBER_FUNCT();
+	Roi hw_roi;
+	getRoi(hw_roi);
+	size = Size(hw_roi.getSize().getWidth() / m_soft_bin.getX(), hw_roi.getSize().getHeight() / m_soft_bin.getY() * m_nb_stacked_frames);
+	DEB_RETURN() << DEB_VAR1(size);
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void Camera::getPixelSize(double& sizex, double& sizey)
+{
+	DEB_MEMBER_FUNCT();
+	//@BEGIN : Get Pixels size in micron from Driver/API			
+	sizex = PIXEL_SIZE_WIDTH_MICRON;
+	sizey = PIXEL_SIZE_HEIGHT_MICRON;
+	//@END
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+HwBufferCtrlObj* Camera::getBufferCtrlObj()
+{
+	return &m_bufferCtrlObj;
+}
+
+//-----------------------------------------------------
+// @brief allocate the Lima buffers with large pages
+//-----------------------------------------------------
+void Camera::setLargePages(bool enable)
+{
+	DEB_MEMBER_FUNCT();
+	DEB_PARAM() << DEB_VAR1(enable);
+	m_bufferCtrlObj.getAllocMgr().setLargePages(enable);
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void Camera::getLargePages(bool& enable)
+{
+	DEB_MEMBER_FUNCT();
+	m_bufferCtrlObj.getAllocMgr().getLargePages(enable);
+	DEB_RETURN() << DEB_VAR1(enable);
+}
+
+//-----------------------------------------------------
+// @brief last allocation of the Lima buffer ring
+//-----------------------------------------------------
+void Camera::getBufferAllocStats(double& alloc_time, size_t& ring_size, bool& large_pages, bool& locked)
+{
+	DEB_MEMBER_FUNCT();
+	m_bufferCtrlObj.getAllocMgr().getAllocStats(alloc_time, ring_size, large_pages, locked);
+	DEB_RETURN() << DEB_VAR4(alloc_time, ring_size, large_pages, locked);
+}
+
+//-----------------------------------------------------
+// @brief NUMA topology and binding of the acquisition
+//-----------------------------------------------------
+void Camera::getCpuBinding(int& nb_nodes, int& numa_node, std::vector<int>& cpus)
+{
+	DEB_MEMBER_FUNCT();
+	nb_nodes = CpuTopology::getNbNodes();
+	numa_node = m_numa_node;
+	cpus = m_acq_cpus;
+	DEB_RETURN() << DEB_VAR2(nb_nodes, numa_node);
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+bool Camera::checkTrigMode(TrigMode mode)
+{
+	DEB_MEMBER_FUNCT();
+	bool valid_mode;
+	//@BEGIN
+	switch(mode)
+	{
+		case IntTrig:
+		case ExtTrigMult:
+		case ExtGate:
+			valid_mode = true;
+			break;
+		case ExtTrigReadout:
+		case ExtTrigSingle:
+		case IntTrigMult:
+		default:
+			valid_mode = false;
+			break;
+	}
+	//@END
+	return valid_mode;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void Camera::setTrigMode(TrigMode mode)
+{
+	DEB_MEMBER_FUNCT();
+	DEB_TRACE() << "setTrigMode() " << DEB_VAR1(mode);
+	DEB_PARAM() << DEB_VAR1(mode);
+	if(m_deferred_commit)
+	{
+		if(!checkTrigMode(mode))
+		{
+			THROW_HW_ERROR(NotSupported) << DEB_VAR1(mode);
+		}
+		m_staged_trig_mode = mode;
+		m_staged_trig_mode_set = true;
+		return;
+	}
+	AutoMutex lock(m_cond.mutex());
+	applyTrigMode(mode);
+}
+
+//-----------------------------------------------------
+// @brief write the trigger mode to TUCAM, with m_cond locked
+//-----------------------------------------------------
+void Camera::applyTrigMode(TrigMode mode)
+{
+	DEB_MEMBER_FUNCT();
+	DEB_PARAM() << DEB_VAR1(mode);
+	//@BEGIN
+	TUCAM_TRIGGER_ATTR tgrAttr;
+	tgrAttr.nTgrMode = -1;//NOT DEFINED (see below)
+	tgrAttr.nFrames = 1;
+	tgrAttr.nDelayTm = 0;
+	tgrAttr.nExpMode = -1;//NOT DEFINED (see below)
+	tgrAttr.nEdgeMode = TUCTD_RISING;
+
+	//the capture can be kept armed if the trigger mode does not change
+	if(NULL != m_hThdEvent)
+	{
+		if(mode == m_trigger_mode)
+			return;
+		disarmForChange();
+	}
+
+	switch(mode)
+	{
+		case IntTrig:
+			tgrAttr.nTgrMode = TUCCM_TRIGGER_SOFTWARE;
+			tgrAttr.nExpMode = TUCTE_EXPTM;
+			TUCAM_Cap_SetTrigger(m_opCam.hIdxTUCam, tgrAttr);
+			DEB_TRACE() << "TUCAM_Cap_SetTrigger : TUCCM_TRIGGER_SOFTWARE (EXPOSURE SOFTWARE)";
+			break;
+		case ExtTrigMult :
+			tgrAttr.nTgrMode = TUCCM_TRIGGER_STANDARD;
+			tgrAttr.nExpMode = TUCTE_EXPTM;
+			TUCAM_Cap_SetTrigger(m_opCam.hIdxTUCam, tgrAttr);
+			DEB_TRACE() << "TUCAM_Cap_SetTrigger : TUCCM_TRIGGER_STANDARD (EXPOSURE SOFTWARE: "<<tgrAttr.nExpMode<<")";
+			break;
+		case ExtGate:		
+			tgrAttr.nTgrMode = TUCCM_TRIGGER_STANDARD;
+			tgrAttr.nExpMode = TUCTE_WIDTH;
+			TUCAM_Cap_SetTrigger(m_opCam.hIdxTUCam, tgrAttr);
+			DEB_TRACE() << "TUCAM_Cap_SetTrigger : TUCCM_TRIGGER_STANDARD (EXPOSURE TRIGGER WIDTH: "<<tgrAttr.nExpMode<<")";
+			break;			
+		case ExtTrigSingle :		
+		case IntTrigMult:
+		case ExtTrigReadout:
+		default:
+			THROW_HW_ERROR(NotSupported) << DEB_VAR1(mode);
+	}
+	//TUCAM_Cap_SetTrigger does not go through the cache, the exposure limits may depend on the trigger mode
+	m_prop_cache.invalidate();
+	m_trigger_mode = mode;
+	m_trig_mode_applied = true;
+	//@END
+
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void Camera::getTrigMode(TrigMode& mode)
+{
+	DEB_MEMBER_FUNCT();
+	mode = m_staged_trig_mode_set ? m_staged_trig_mode : m_trigger_mode;
+}
+
+void Camera::getTriggerMode(TucamTriggerMode &mode)
+{
+	DEB_MEMBER_FUNCT();
+	mode = m_tucam_trigger_mode;
+}
+
+void Camera::setTriggerMode(TucamTriggerMode mode)
+{
+	DEB_MEMBER_FUNCT();
+	m_tucam_trigger_mode = mode;
+}
+
+void Camera::getInternalTriggerMode(InternalTriggerMode &mode)
+{
+	DEB_MEMBER_FUNCT();
+	mode = m_int_trigger_mode;
+}
+
+void Camera::setInternalTriggerMode(InternalTriggerMode mode)
+{
+	DEB_MEMBER_FUNCT();
+	DEB_PARAM() << DEB_VAR1(mode);
+	m_int_trigger_mode = mode;
+}
+
+void Camera::getTriggerEdge(TucamTriggerEdge &edge)
+{
+	DEB_MEMBER_FUNCT();
+	edge = m_tucam_trigger_edge_mode;
+}
+
+void Camera::setTriggerEdge(TucamTriggerEdge edge)
+{
+	DEB_MEMBER_FUNCT();
+	m_tucam_trigger_edge_mode = edge;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void Camera::getExpTime(double& exp_time)
+{
+	DEB_MEMBER_FUNCT();
+	if(m_staged_exp_time_set)
+	{
+		//not written to TUCAM yet
+		exp_time = m_staged_exp_time;
+		DEB_RETURN() << DEB_VAR1(exp_time);
+		return;
+	}
+	//@BEGIN
+	double dbVal;
+	if(TUCAMRET_SUCCESS != m_prop_cache.getProp(TUIDP_EXPOSURETM, dbVal))
+	{
+		THROW_HW_ERROR(Error) << "Unable to Read TUIDP_EXPOSURETM from the camera !";
+	}
+	m_exp_time = dbVal / 1000;//TUCAM use (ms), but lima use (second) as unit 
+	//@END
+	exp_time = m_exp_time;
+	DEB_RETURN() << DEB_VAR1(exp_time);
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void Camera::setExpTime(double exp_time)
+{
+	DEB_MEMBER_FUNCT();
+	DEB_TRACE() << "setExpTime() " << DEB_VAR1(exp_time);
+	if(m_deferred_commit)
+	{
+		m_staged_exp_time = exp_time;
+		m_staged_exp_time_set = true;
+		return;
+	}
+	applyExpTime(exp_time);
+}
+
+//-----------------------------------------------------
+// @brief write the exposure time to TUCAM
+//-----------------------------------------------------
+void Camera::applyExpTime(double exp_time)
+{
+	DEB_MEMBER_FUNCT();
+	DEB_PARAM() << DEB_VAR1(exp_time);
+	//@BEGIN
+	if(TUCAMRET_SUCCESS != m_prop_cache.setProp(TUIDP_EXPOSURETM, exp_time * 1000))//TUCAM use (ms), but lima use (second) as unit 
+	{
+		THROW_HW_ERROR(Error) << "Unable to Write TUIDP_EXPOSURETM to the camera !";
+	}
+	//@END
+	m_exp_time = exp_time;
+	m_applied_exp_time = exp_time;
+}
+
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void Camera::setLatTime(double lat_time)
+{
+	DEB_MEMBER_FUNCT();
+	DEB_TRACE() << "setLatTime() " << DEB_VAR1(lat_time);
+	m_lat_time = lat_time;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void Camera::getLatTime(double& lat_time)
+{
+	DEB_MEMBER_FUNCT();
+	//@BEGIN
+	//@END
+	lat_time = m_lat_time;
+	DEB_RETURN() << DEB_VAR1(lat_time);
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void Camera::getExposureTimeRange(double& min_expo, double& max_expo) const
+{
+	DEB_MEMBER_FUNCT();
+	//@BEGIN
+	min_expo = 0.;
+	max_expo = 10;//10s
+	//@END
+	DEB_RETURN() << DEB_VAR2(min_expo, max_expo);
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void Camera::getLatTimeRange(double& min_lat, double& max_lat) const
+{
+	DEB_MEMBER_FUNCT();
+	//@BEGIN
+	// --- no info on min latency
+	min_lat = 0.;
+	// --- do not know how to get the max_lat, fix it as the max exposure time
+	max_lat = 10;//10s
+	//@END
+	DEB_RETURN() << DEB_VAR2(min_lat, max_lat);
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void Camera::setNbFrames(int nb_frames)
+{
+	DEB_MEMBER_FUNCT();
+	DEB_TRACE() << "setNbFrames() " << DEB_VAR1(nb_frames);
+	//@BEGIN
+	if(nb_frames < 0)
+	{
+		THROW_HW_ERROR(Error) << "Number of frames to acquire has not been set";
+	}
+	if(nb_frames > 1)
+	{
+		//THROW_HW_ERROR(Error) << "Unable to acquire more than 1 frame ! ";	//T@D@ allowed only for test 
+	}
+	//@END
+	m_nb_frames = nb_frames;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void Camera::getNbFrames(int& nb_frames)
+{
+	DEB_MEMBER_FUNCT();
+	DEB_RETURN() << DEB_VAR1(m_nb_frames);
+	//@BEGIN
+	//@END
+	nb_frames = m_nb_frames;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+int Camera::getNbHwAcquiredFrames()
+{
+	DEB_MEMBER_FUNCT();
+	return m_acq_frame_nb.load(std::memory_order_acquire);
+}
+
+//-----------------------------------------------------
+// @brief range the binning to the maximum allowed
+//-----------------------------------------------------
+void Camera::checkBin(Bin &hw_bin)
+{
+	DEB_MEMBER_FUNCT();
+
+	//@BEGIN : check available values of binning H/V
+	//any NxM binning is done in software
+	int x = hw_bin.getX();
+	int y = hw_bin.getY();
+	if(x < 1 || y < 1 || x > PIXEL_NB_WIDTH || y > PIXEL_NB_HEIGHT)
+	{
+		DEB_ERROR() << "Binning values not supported";
+		THROW_HW_ERROR(Error) << "Binning values not supported = " << DEB_VAR1(hw_bin);
+	}
+	//@END
+
+	hw_bin = Bin(x, y);
+	DEB_RETURN() << DEB_VAR1(hw_bin);
+}
+//-----------------------------------------------------
+// @brief set the new binning mode
+//-----------------------------------------------------
+void Camera::setBin(const Bin &set_bin)
+{
+	DEB_MEMBER_FUNCT();
+
+	AutoMutex lock(m_cond.mutex());
+	if(!(set_bin == m_bin) && isAcqRunning())
+	{
+		THROW_HW_ERROR(Error) << "Unable to change the binning while acquisition is running !";
+	}
+	//@BEGIN : set binning H/V to the Driver/API
+	//the largest hardware mode dividing the binning, the rest is done on the copy to the Lima buffer
+	int x = set_bin.getX();
+	int y = set_bin.getY();
+	Bin hw_bin(1, 1);
+	int mode = m_full_resolution;
+	for(size_t i = 0; i < m_hw_bins.size(); i++)
+	{
+		const Bin& bin = m_hw_bins[i];
+		if(x % bin.getX() == 0 && y % bin.getY() == 0 && bin.getX() * bin.getY() > hw_bin.getX() * hw_bin.getY())
+		{
+			hw_bin = bin;
+			mode = m_hw_bin_modes[i];
+		}
+	}
+	if(!(hw_bin == m_hw_bin))
+	{
+		//the AcqThread may still be in the capture, the resolution can not change under it
+		if(m_acq_state == kAcqFault)
+		{
+			THROW_HW_ERROR(Error) << "Camera is in fault, a reset is needed !";
+		}
+		disarmForChange();
+		DEB_TRACE() << "Set TUIDC_RESOLUTION " << mode << " : " << DEB_VAR1(hw_bin);
+		if(TUCAMRET_SUCCESS != m_prop_cache.setCapa(TUIDC_RESOLUTION, mode))
+		{
+			THROW_HW_ERROR(Error) << "Unable to Write TUIDC_RESOLUTION to the camera !";
+		}
+		m_hw_bin = hw_bin;
+
+		//the roi of the previous mode may not fit in the new resolution : it is reset to the full frame
+		Size size;
+		getResolutionSize(size);
+		TUCAM_ROI_ATTR roiAttr;
+		if(TUCAMRET_SUCCESS != m_prop_cache.getRoi(roiAttr) ||
+		   roiAttr.nHOffset + roiAttr.nWidth > size.getWidth() || roiAttr.nVOffset + roiAttr.nHeight > size.getHeight())
+		{
+			DEB_TRACE() << "Roi reset to the full " << size << " frame";
+			applyRoi(Roi());
+		}
+		if(m_staged_roi_set && (m_staged_roi.getBottomRight().x >= size.getWidth() || m_staged_roi.getBottomRight().y >= size.getHeight()))
+		{
+			m_staged_roi = Roi(0, 0, size.getWidth(), size.getHeight());
+		}
+	}
+	//@END
+	m_bin = set_bin;
+	m_soft_bin = Bin(x / hw_bin.getX(), y / hw_bin.getY());
+	DEB_TRACE() << DEB_VAR2(m_hw_bin, m_soft_bin);
+
+	DEB_RETURN() << DEB_VAR1(set_bin);
+}
+
+//-----------------------------------------------------
+// @brief return the current binning mode
+//-----------------------------------------------------
+void Camera::getBin(Bin &hw_bin)
+{
+	DEB_MEMBER_FUNCT();
+
+	//@BEGIN : get binning from Driver/API
+	//...
+	//@END
+	hw_bin = m_bin;
+
+	DEB_RETURN() << DEB_VAR1(hw_bin);
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void Camera::getHwBinModes(std::vector<Bin>& hw_bins)
+{
+	DEB_MEMBER_FUNCT();
+	hw_bins = m_hw_bins;
+	DEB_RETURN() << DEB_VAR1(hw_bins.size());
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void Camera::getBinSplit(Bin& hw_bin, Bin& soft_bin)
+{
+	DEB_MEMBER_FUNCT();
+	hw_bin = m_hw_bin;
+	soft_bin = m_soft_bin;
+	DEB_RETURN() << DEB_VAR2(hw_bin, soft_bin);
+}
+
+//-----------------------------------------------------
+// @brief size of the TUCAM frame without roi in the current resolution mode
+//-----------------------------------------------------
+void Camera::getResolutionSize(Size& size)
+{
+	size = Size(PIXEL_NB_WIDTH / m_hw_bin.getX(), PIXEL_NB_HEIGHT / m_hw_bin.getY());
+}
+
+//-----------------------------------------------------
+//! Camera::checkRoi()
+//-----------------------------------------------------
+void Camera::checkRoi(const Roi& set_roi, Roi& hw_roi)
+{
+	DEB_MEMBER_FUNCT();
+	DEB_TRACE() << "checkRoi";
+	DEB_PARAM() << DEB_VAR1(set_roi);
+	//@BEGIN : check available values of Roi
+	if(set_roi.isActive())
+	{
+		Size size;
+		getResolutionSize(size);
+		Point top_left = set_roi.getTopLeft();
+		Point bottom_right = set_roi.getBottomRight();
+		if(top_left.x < 0 || top_left.y < 0 || bottom_right.x >= size.getWidth() || bottom_right.y >= size.getHeight())
+		{
+			THROW_HW_ERROR(InvalidValue) << "Roi does not fit in the " << size << " camera frame : " << DEB_VAR1(set_roi);
+		}
+		hw_roi = set_roi;
+	}
+	else
+	{
+		hw_roi = set_roi;
+	}
+	//@END
+
+
+	DEB_RETURN() << DEB_VAR1(hw_roi);
+}
+
+//---------------------------------------------------------------------------------------
+//! Camera::getRoi()
+//---------------------------------------------------------------------------------------
+void Camera::getRoi(Roi& hw_roi)
+{
+	DEB_MEMBER_FUNCT();
+	if(m_staged_roi_set)
+	{
+		//not written to TUCAM yet
+		hw_roi = m_staged_roi;
+		DEB_RETURN() << DEB_VAR1(hw_roi);
+		return;
+	}
+	//@BEGIN : get Roi from the Driver/API
+	TUCAM_ROI_ATTR roiAttr;
+	if(TUCAMRET_SUCCESS != m_prop_cache.getRoi(roiAttr))
+	{
+		THROW_HW_ERROR(Error) << "Unable to GetRoi from  the camera !";
+	}
+	hw_roi = Roi(roiAttr.nHOffset,
+				roiAttr.nVOffset,
+				roiAttr.nWidth,
+				roiAttr.nHeight);
+	//@END
+
+	DEB_RETURN() << DEB_VAR1(hw_roi);
+}
+
+//---------------------------------------------------------------------------------------
+//! Camera::setRoi()
+//---------------------------------------------------------------------------------------
+void Camera::setRoi(const Roi& set_roi)
+{
+	DEB_MEMBER_FUNCT();
+	DEB_TRACE() << "setRoi";
+	DEB_PARAM() << DEB_VAR1(set_roi);
+	if(m_deferred_commit)
+	{
+		Size size;
+		getResolutionSize(size);
+		m_staged_roi = set_roi.isActive() ? set_roi : Roi(0, 0, size.getWidth(), size.getHeight());
+		m_staged_roi_set = true;
+		return;
+	}
+	AutoMutex lock(m_cond.mutex());
+	applyRoi(set_roi);
+}
+
+//---------------------------------------------------------------------------------------
+//! Camera::applyRoi() : write the roi to TUCAM, with m_cond locked
+//---------------------------------------------------------------------------------------
+void Camera::applyRoi(const Roi& set_roi)
+{
+	DEB_MEMBER_FUNCT();
+	DEB_PARAM() << DEB_VAR1(set_roi);
+
+	//the capture can be kept armed if the roi does not change
+	if(NULL != m_hThdEvent)
+	{
+		Roi hw_roi;
+		getRoi(hw_roi);
+		Size size;
+		getResolutionSize(size);
+		Roi new_roi = set_roi.isActive() ? set_roi : Roi(0, 0, size.getWidth(), size.getHeight());
+		if(new_roi == hw_roi)
+			return;
+		disarmForChange();
+	}
+	//@BEGIN : set Roi from the Driver/API	
+	if(!set_roi.isActive())
+	{
+		DEB_TRACE() << "Roi is not Enabled : so set full frame";
+
+		//set Roi to Driver/API
+		Size size;
+		getResolutionSize(size);
+		TUCAM_ROI_ATTR roiAttr;
+		roiAttr.bEnable = TRUE;
+		roiAttr.nHOffset = 0;
+		roiAttr.nVOffset = 0;
+		roiAttr.nWidth = size.getWidth();
+		roiAttr.nHeight = size.getHeight();
+
+		if(TUCAMRET_SUCCESS != m_prop_cache.setRoi(roiAttr))
+		{
+			THROW_HW_ERROR(Error) << "Unable to SetRoi to the camera !";
+		}
+
+	}
+	else
+	{
+		DEB_TRACE() << "Roi is Enabled";
+		//set Roi to Driver/API
+		TUCAM_ROI_ATTR roiAttr;
+		roiAttr.bEnable = TRUE;
+		roiAttr.nHOffset = set_roi.getTopLeft().x;
+		roiAttr.nVOffset = set_roi.getTopLeft().y;
+		roiAttr.nWidth = set_roi.getSize().getWidth();
+		roiAttr.nHeight = set_roi.getSize().getHeight();
+
+		if(TUCAMRET_SUCCESS != m_prop_cache.setRoi(roiAttr))
+		{
+			THROW_HW_ERROR(Error) << "Unable to SetRoi to the camera !";
+		}
+	}
+	//the camera may have clamped the exposure to the new readout : a staged exposure is always written again
+	m_applied_exp_time = -1.0;
+	//@END	
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+bool Camera::isAcqRunning() const
+{
+	DEB_MEMBER_FUNCT();
+	AcqState state = m_acq_state;
+	bool running = (state == kAcqRunning || state == kAcqStopping);
+	DEB_TRACE() << "isAcqRunning - " << DEB_VAR1(running) << "---------------------------";
+	return running;
+}
+
+///////////////////////////////////////////////////////
+// Dhyana specific stuff now
+///////////////////////////////////////////////////////
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------  
+void Camera::setTemperatureTarget(double temp)
+{
+	DEB_MEMBER_FUNCT();
+	TUCAM_PROP_ATTR attrProp;
+	attrProp.nIdxChn = 0;// Current channel (camera monochrome = 0) . VERY IMPORTANT, doesn't work otherwise !!!!!
+	attrProp.idProp = TUIDP_TEMPERATURE;
+	if(TUCAMRET_SUCCESS != TUCAM_Prop_GetAttr(m_opCam.hIdxTUCam, &attrProp))
+	{
+		THROW_HW_ERROR(Error) << "Unable to Read TUIDP_TEMPERATURE range from the camera !";
+	}
+	DEB_TRACE() << "Temperature range [" << (int) attrProp.dbValMin << " , " << (int) attrProp.dbValMax << "]";
+
+	int temp_middle = (int) attrProp.dbValMax / 2;
+	if(((int) temp + temp_middle)<((int) attrProp.dbValMin) || ((int) temp + temp_middle)>((int) attrProp.dbValMax))
+	{
+		THROW_HW_ERROR(Error) << "Unable to set the Temperature Target !\n"
+		 << "It is out of range : "
+		 << "["
+		 << (int) attrProp.dbValMin - temp_middle
+		 << ","
+		 << (int) attrProp.dbValMax - temp_middle
+		 << "]";
+	}
+
+	int nVal = (int) temp + temp_middle;//temperatureTarget is a delta according to the middle temperature !!
+	if(TUCAMRET_SUCCESS != TUCAM_Prop_SetValue(m_opCam.hIdxTUCam, TUIDP_TEMPERATURE, nVal))
+	{
+		THROW_HW_ERROR(Error) << "Unable to Write TUIDP_TEMPERATURE to the camera !";
+	}
+	m_temperature_target = (double) temp;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------  
+void Camera::getTemperatureTarget(double& temp)
+{
+	DEB_MEMBER_FUNCT();
+
+	temp = m_temperature_target;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------  
+void Camera::getTemperature(double& temp)
+{
+	DEB_MEMBER_FUNCT();
+
+	double dbVal = 0.0f;
+	if(TUCAMRET_SUCCESS != TUCAM_Prop_GetValue(m_opCam.hIdxTUCam, TUIDP_TEMPERATURE, &dbVal))
+	{
+		THROW_HW_ERROR(Error) << "Unable to Read TUIDP_TEMPERATURE from the camera !";
+	}
+	temp = dbVal;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------  
+void Camera::setFanSpeed(unsigned speed)
+{
+	DEB_MEMBER_FUNCT();
+
+	int nVal = (int) speed;
+
+	if(TUCAMRET_SUCCESS != m_prop_cache.setCapa(TUIDC_FAN_GEAR, nVal))
+	{
+		THROW_HW_ERROR(Error) << "Unable to Write TUIDC_FAN_GEAR to the camera !";
+	}
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------  
+void Camera::getFanSpeed(unsigned& speed)
+{
+	DEB_MEMBER_FUNCT();
+
+	int nVal;
+	if(TUCAMRET_SUCCESS != m_prop_cache.getCapa(TUIDC_FAN_GEAR, nVal))
+	{
+		THROW_HW_ERROR(Error) << "Unable to Read TUIDC_FAN_GEAR from the camera !";
+	}
+	speed = (unsigned) nVal;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------  
+void Camera::setGlobalGain(unsigned gain)
+{
+	DEB_MEMBER_FUNCT();
+
+	if(gain != 0 && gain != 1 && gain != 2)
+	{
+		THROW_HW_ERROR(Error) << "Available gain values are : 0:HDR\n1:HIGH\n2: LOW !";
+	}
+
+	double dbVal = (double) gain;
+	if(TUCAMRET_SUCCESS != m_prop_cache.setProp(TUIDP_GLOBALGAIN, dbVal))
+	{
+		THROW_HW_ERROR(Error) << "Unable to Write TUIDP_GLOBALGAIN to the camera !";
+	}
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------  
+void Camera::getGlobalGain(unsigned& gain)
+{
+	DEB_MEMBER_FUNCT();
+
+	double dbVal;
+	if(TUCAMRET_SUCCESS != m_prop_cache.getProp(TUIDP_GLOBALGAIN, dbVal))
+	{
+		THROW_HW_ERROR(Error) << "Unable to Read TUIDP_GLOBALGAIN from the camera !";
+	}
+	gain = (unsigned) dbVal;
+}
+
+//-----------------------------------------------------
+// @brief read the TUCAM values again on each get and count the ones that changed behind the cache
+//-----------------------------------------------------
+void Camera::setCacheVerify(bool enable)
+{
+	DEB_MEMBER_FUNCT();
+	DEB_PARAM() << DEB_VAR1(enable);
+	m_prop_cache.setVerify(enable);
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void Camera::getCacheVerify(bool& enable)
+{
+	DEB_MEMBER_FUNCT();
+	enable = m_prop_cache.getVerify();
+	DEB_RETURN() << DEB_VAR1(enable);
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void Camera::invalidateCache()
+{
+	DEB_MEMBER_FUNCT();
+	m_prop_cache.invalidate();
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void Camera::getCacheStats(int& nb_hits, int& nb_misses, int& nb_mismatches)
+{
+	DEB_MEMBER_FUNCT();
+	m_prop_cache.getStats(nb_hits, nb_misses, nb_mismatches);
+	DEB_RETURN() << DEB_VAR3(nb_hits, nb_misses, nb_mismatches);
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void Camera::getTucamVersion(std::string& version)
+{
+	DEB_MEMBER_FUNCT();
+	TUCAM_VALUE_INFO valInfo;
+	valInfo.nID = TUIDI_VERSION_API;
+	if(TUCAMRET_SUCCESS != TUCAM_Dev_GetInfo(m_opCam.hIdxTUCam, &valInfo))
+	{
+		THROW_HW_ERROR(Error) << "Unable to Read TUIDI_VERSION_API from the camera !";
+	}
+	version = valInfo.pText;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------  
+void Camera::getFirmwareVersion(std::string& version)
+{
+	DEB_MEMBER_FUNCT();
+	TUCAM_VALUE_INFO valInfo;
+	valInfo.nID = TUIDI_VERSION_FRMW;
+	if(TUCAMRET_SUCCESS != TUCAM_Dev_GetInfo(m_opCam.hIdxTUCam, &valInfo))
+	{
+		THROW_HW_ERROR(Error) << "Unable to Read TUIDI_VERSION_FRMW from the camera !";
+	}
+	version = valInfo.nValue;
 }
 
-//-----------------------------------------------------
-//
-//-----------------------------------------------------
-Camera::AcqThread::~AcqThread()
+//-----------------------------------------------------------------------------
+/// Get the frame rate
+//-----------------------------------------------------------------------------
+void Camera::getFPS(double& fps) ///< [out] last computed fps
 {
-	AutoMutex aLock(m_cam.m_cond.mutex());
-	m_cam.m_wait_flag = true;
-	m_cam.m_quit = true;
-	m_cam.m_cond.broadcast();
-	aLock.unlock();
-	join();
+    DEB_MEMBER_FUNCT();
+
+    fps = m_frame_rate.getWindowRate(CBaseTimer::now());
 }
 
 //-----------------------------------------------------
 //
 //-----------------------------------------------------
-void Camera::getImageType(ImageType& type)
+void Camera::getFrameRate(double& instant_fps, double& window_fps, double& min_window_fps)
 {
 	DEB_MEMBER_FUNCT();
-	//@BEGIN : Fix the image type (pixel depth) into Driver/API		
-	switch(m_depth)
-	{
-		case 16: type = Bpp16;
-			break;
-		default:
-			THROW_HW_ERROR(Error) << "This pixel format of the camera is not managed, only 16 bits cameras are already managed!";
-			break;
-	}
-	//@END	
-	return;
+	instant_fps = m_frame_rate.getInstantRate();
+	window_fps = m_frame_rate.getWindowRate(CBaseTimer::now());
+	min_window_fps = m_frame_rate.getMinWindowRate();
+	DEB_RETURN() << DEB_VAR3(instant_fps, window_fps, min_window_fps);
 }
 
 //-----------------------------------------------------
 //
 //-----------------------------------------------------
-void Camera::setImageType(ImageType type)
+void Camera::getFrameStalls(int& nb_stalls, double& max_gap)
 {
 	DEB_MEMBER_FUNCT();
-	DEB_TRACE() << "setImageType - " << DEB_VAR1(type);
-	//@BEGIN : Fix the image type (pixel depth) into Driver/API	
-	switch(type)
-	{
-		case Bpp16:
-			m_depth = 16;
-			break;
-		default:
-			THROW_HW_ERROR(Error) << "This pixel format of the camera is not managed, only 16 bits cameras are already managed!";
-			break;
-	}
-	//@END	
+	double now = CBaseTimer::now();
+	nb_stalls = m_frame_rate.getNbStalls(now);
+	max_gap = m_frame_rate.getMaxGap(now);
+	DEB_RETURN() << DEB_VAR2(nb_stalls, max_gap);
 }
 
 //-----------------------------------------------------
 //
 //-----------------------------------------------------
-void Camera::getDetectorType(std::string& type)
+void Camera::getTimeSinceLastFrame(double& time)
 {
 	DEB_MEMBER_FUNCT();
-	//@BEGIN : Get Detector type from Driver/API
-	type = "Tucsen - Dhyana";
-	//@END	
-
+	time = m_frame_rate.getTimeSinceLastFrame(CBaseTimer::now());
+	DEB_RETURN() << DEB_VAR1(time);
 }
 
 //-----------------------------------------------------
 //
 //-----------------------------------------------------
-void Camera::getDetectorModel(std::string& model)
+void Camera::setFrameStallFactor(double stall_factor)
 {
 	DEB_MEMBER_FUNCT();
-	//@BEGIN : Get Detector model/type from Driver/API
-	stringstream ss;
-	TUCAM_VALUE_INFO valInfo;
-	valInfo.nID = TUIDI_CAMERA_MODEL;
-	if(TUCAMRET_SUCCESS != TUCAM_Dev_GetInfo(m_opCam.hIdxTUCam, &valInfo))
+	DEB_PARAM() << DEB_VAR1(stall_factor);
+	if(stall_factor <= 1.0)
 	{
-		THROW_HW_ERROR(Error) << "Unable to Read TUIDI_CAMERA_MODEL from the camera !";
+		THROW_HW_ERROR(InvalidValue) << "The stall factor must be greater than 1 : " << DEB_VAR1(stall_factor);
 	}
-	ss << valInfo.pText;
-	model = ss.str();
-	//@END		
+	m_frame_stall_factor = stall_factor;
 }
 
 //-----------------------------------------------------
 //
 //-----------------------------------------------------
-void Camera::getDetectorImageSize(Size& size)
+void Camera::getFrameStallFactor(double& stall_factor)
 {
 	DEB_MEMBER_FUNCT();
-
-	//@BEGIN : Get Detector size in pixels from Driver/API
-	size = Size(PIXEL_NB_WIDTH, PIXEL_NB_HEIGHT);
-	//@END
+	stall_factor = m_frame_stall_factor;
+	DEB_RETURN() << DEB_VAR1(stall_factor);
 }
 
 //-----------------------------------------------------
-//
+// @brief enable/disable the zero-copy frame delivery
 //-----------------------------------------------------
-void Camera::getPixelSize(double& sizex, double& sizey)
+void Camera::setZeroCopy(bool enable)
 {
 	DEB_MEMBER_FUNCT();
-	//@BEGIN : Get Pixels size in micron from Driver/API			
-	sizex = PIXEL_SIZE_WIDTH_MICRON;
-	sizey = PIXEL_SIZE_HEIGHT_MICRON;
-	//@END
+	DEB_PARAM() << DEB_VAR1(enable);
+	AutoMutex aLock(m_cond.mutex());
+	if(m_acq_state == kAcqRunning)
+	{
+		THROW_HW_ERROR(Error) << "Unable to change the zero-copy mode while acquisition is running !";
+	}
+	m_zero_copy = enable;
+	m_bufferCtrlObj.setZeroCopy(enable, SDK_BUFFER_MAX_DEPTH - ZERO_COPY_SDK_MARGIN);
 }
 
 //-----------------------------------------------------
 //
 //-----------------------------------------------------
-HwBufferCtrlObj* Camera::getBufferCtrlObj()
+void Camera::getZeroCopy(bool& enable)
 {
-	return &m_bufferCtrlObj;
+	DEB_MEMBER_FUNCT();
+	enable = m_zero_copy;
+	DEB_RETURN() << DEB_VAR1(enable);
 }
 
 //-----------------------------------------------------
-//
+// @brief set the depth of the TUCAM frame reservation (0 = auto)
 //-----------------------------------------------------
-bool Camera::checkTrigMode(TrigMode mode)
+void Camera::setSdkBufferDepth(int depth)
 {
 	DEB_MEMBER_FUNCT();
-	bool valid_mode;
-	//@BEGIN
-	switch(mode)
+	DEB_PARAM() << DEB_VAR1(depth);
+	if(depth < 0 || depth > SDK_BUFFER_MAX_DEPTH)
 	{
-		case IntTrig:
-		case ExtTrigMult:
-		case ExtGate:
-			valid_mode = true;
-			break;
-		case ExtTrigReadout:
-		case ExtTrigSingle:
-		case IntTrigMult:
-		default:
-			valid_mode = false;
-			break;
+		THROW_HW_ERROR(InvalidValue) << "SDK buffer depth must be in [0, " << SDK_BUFFER_MAX_DEPTH << "] (0 = auto) !";
 	}
-	//@END
-	return valid_mode;
+	if(depth != m_sdk_buffer_depth)
+	{
+		AutoMutex lock(m_cond.mutex());
+		disarmForChange();
+	}
+	m_sdk_buffer_depth = depth;
 }
 
 //-----------------------------------------------------
-//
+// @brief return the requested depth, or the one in use if auto
 //-----------------------------------------------------
-void Camera::setTrigMode(TrigMode mode)
+void Camera::getSdkBufferDepth(int& depth)
 {
 	DEB_MEMBER_FUNCT();
-	DEB_TRACE() << "setTrigMode() " << DEB_VAR1(mode);
-	DEB_PARAM() << DEB_VAR1(mode);
-	//@BEGIN
-	TUCAM_TRIGGER_ATTR tgrAttr;
-	tgrAttr.nTgrMode = -1;//NOT DEFINED (see below)
-	tgrAttr.nFrames = 1;
-	tgrAttr.nDelayTm = 0;
-	tgrAttr.nExpMode = -1;//NOT DEFINED (see below)
-	tgrAttr.nEdgeMode = TUCTD_RISING;
+	depth = (m_sdk_buffer_depth > 0) ? m_sdk_buffer_depth : m_sdk_buffer_depth_used;
+	DEB_RETURN() << DEB_VAR1(depth);
+}
 
-	switch(mode)
-	{
-		case IntTrig:
-			tgrAttr.nTgrMode = TUCCM_TRIGGER_SOFTWARE;
-			tgrAttr.nExpMode = TUCTE_EXPTM;
-			TUCAM_Cap_SetTrigger(m_opCam.hIdxTUCam, tgrAttr);
-			DEB_TRACE() << "TUCAM_Cap_SetTrigger : TUCCM_TRIGGER_SOFTWARE (EXPOSURE SOFTWARE)";
-			break;
-		case ExtTrigMult :
-			tgrAttr.nTgrMode = TUCCM_TRIGGER_STANDARD;
-			tgrAttr.nExpMode = TUCTE_EXPTM;
-			TUCAM_Cap_SetTrigger(m_opCam.hIdxTUCam, tgrAttr);
-			DEB_TRACE() << "TUCAM_Cap_SetTrigger : TUCCM_TRIGGER_STANDARD (EXPOSURE SOFTWARE: "<<tgrAttr.nExpMode<<")";
-			break;
-		case ExtGate:		
-			tgrAttr.nTgrMode = TUCCM_TRIGGER_STANDARD;
-			tgrAttr.nExpMode = TUCTE_WIDTH;
-			TUCAM_Cap_SetTrigger(m_opCam.hIdxTUCam, tgrAttr);
-			DEB_TRACE() << "TUCAM_Cap_SetTrigger : TUCCM_TRIGGER_STANDARD (EXPOSURE TRIGGER WIDTH: "<<tgrAttr.nExpMode<<")";
-			break;			
-		case ExtTrigSingle :		
-		case IntTrigMult:
-		case ExtTrigReadout:
-		default:
-			THROW_HW_ERROR(NotSupported) << DEB_VAR1(mode);
-	}
-	m_trigger_mode = mode;
-	//@END
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void Camera::getSdkBufferMaxUsage(int& usage)
+{
+	DEB_MEMBER_FUNCT();
+	usage = m_sdk_buffer_max_usage;
+	DEB_RETURN() << DEB_VAR1(usage);
+}
 
+//-----------------------------------------------------
+// @brief statistics of the frame queue for the last acquisition
+//-----------------------------------------------------
+void Camera::getFrameQueueStats(int& high_water_mark, int& nb_stalls)
+{
+	DEB_MEMBER_FUNCT();
+	high_water_mark = m_frame_queue.getHighWaterMark();
+	nb_stalls = m_nb_queue_stalls;
+	DEB_RETURN() << DEB_VAR2(high_water_mark, nb_stalls);
 }
 
 //-----------------------------------------------------
 //
 //-----------------------------------------------------
-void Camera::getTrigMode(TrigMode& mode)
+void Camera::getSdkBufferReuse(bool& reuse)
 {
 	DEB_MEMBER_FUNCT();
-	mode = m_trigger_mode;
+	reuse = m_sdk_buffer_reuse;
+	DEB_RETURN() << DEB_VAR1(reuse);
 }
 
-void Camera::getTriggerMode(TucamTriggerMode &mode)
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void Camera::getNbCopyThreads(int& nb_threads)
 {
 	DEB_MEMBER_FUNCT();
-	mode = m_tucam_trigger_mode;
+	nb_threads = m_copy_engine ? m_copy_engine->getNbThreads() : 0;
+	DEB_RETURN() << DEB_VAR1(nb_threads);
 }
 
-void Camera::setTriggerMode(TucamTriggerMode mode)
+//-----------------------------------------------------
+// @brief name of the frame copy kernel selected for this cpu
+//-----------------------------------------------------
+void Camera::getCopyKernel(std::string& kernel)
 {
 	DEB_MEMBER_FUNCT();
-	m_tucam_trigger_mode = mode;
+	kernel = CopyKernel::getName();
+	DEB_RETURN() << DEB_VAR1(kernel);
 }
 
-void Camera::getTriggerEdge(TucamTriggerEdge &edge)
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void Camera::setSequenceMode(bool enable)
 {
 	DEB_MEMBER_FUNCT();
-	edge = m_tucam_trigger_edge_mode;
+	DEB_PARAM() << DEB_VAR1(enable);
+	m_sequence_mode = enable;
 }
 
-void Camera::setTriggerEdge(TucamTriggerEdge edge)
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void Camera::getSequenceMode(bool& enable)
 {
 	DEB_MEMBER_FUNCT();
-	m_tucam_trigger_edge_mode = edge;
+	enable = m_sequence_mode;
+	DEB_RETURN() << DEB_VAR1(enable);
 }
 
 //-----------------------------------------------------
 //
 //-----------------------------------------------------
-void Camera::getExpTime(double& exp_time)
+void Camera::setKeepArmed(bool enable)
 {
 	DEB_MEMBER_FUNCT();
-	//@BEGIN
-	double dbVal;
-	if(TUCAMRET_SUCCESS != TUCAM_Prop_GetValue(m_opCam.hIdxTUCam, TUIDP_EXPOSURETM, &dbVal))
+	DEB_PARAM() << DEB_VAR1(enable);
+	AutoMutex lock(m_cond.mutex());
+	m_keep_armed = enable;
+	//a running acquisition releases the capture when it ends
+	if(!enable && m_acq_state == kAcqArmed)
 	{
-		THROW_HW_ERROR(Error) << "Unable to Read TUIDP_EXPOSURETM from the camera !";
+		disarmForChange();
 	}
-	m_exp_time = dbVal / 1000;//TUCAM use (ms), but lima use (second) as unit 
-	//@END
-	exp_time = m_exp_time;
-	DEB_RETURN() << DEB_VAR1(exp_time);
 }
 
 //-----------------------------------------------------
 //
 //-----------------------------------------------------
-void Camera::setExpTime(double exp_time)
+void Camera::getKeepArmed(bool& enable)
 {
 	DEB_MEMBER_FUNCT();
-	DEB_TRACE() << "setExpTime() " << DEB_VAR1(exp_time);
-	//@BEGIN
-	if(TUCAMRET_SUCCESS != TUCAM_Prop_SetValue(m_opCam.hIdxTUCam, TUIDP_EXPOSURETM, exp_time * 1000))//TUCAM use (ms), but lima use (second) as unit 
-	{
-		THROW_HW_ERROR(Error) << "Unable to Write TUIDP_EXPOSURETM to the camera !";
-	}
-	//@END
-	m_exp_time = exp_time;
+	enable = m_keep_armed;
+	DEB_RETURN() << DEB_VAR1(enable);
 }
 
-
 //-----------------------------------------------------
 //
 //-----------------------------------------------------
-void Camera::setLatTime(double lat_time)
+void Camera::getSetupTimes(double& prepare_time, double& start_time, bool& rearmed)
 {
 	DEB_MEMBER_FUNCT();
-	DEB_TRACE() << "setLatTime() " << DEB_VAR1(lat_time);
-	m_lat_time = lat_time;
+	prepare_time = m_prepare_time;
+	start_time = m_start_time;
+	rearmed = m_prepare_rearmed;
+	DEB_RETURN() << DEB_VAR3(prepare_time, start_time, rearmed);
 }
 
 //-----------------------------------------------------
 //
 //-----------------------------------------------------
-void Camera::getLatTime(double& lat_time)
+void Camera::getNbArms(int& nb_arms, int& nb_reuses)
 {
 	DEB_MEMBER_FUNCT();
-	//@BEGIN
-	//@END
-	m_lat_time = lat_time;
-	DEB_RETURN() << DEB_VAR1(lat_time);
+	nb_arms = m_nb_arms;
+	nb_reuses = m_nb_arm_reuses;
+	DEB_RETURN() << DEB_VAR2(nb_arms, nb_reuses);
 }
 
 //-----------------------------------------------------
-//
+// @brief arm a step scan for the next acquisition
 //-----------------------------------------------------
-void Camera::getExposureTimeRange(double& min_expo, double& max_expo) const
+void Camera::armScan(int nb_points, int frames_per_point)
 {
 	DEB_MEMBER_FUNCT();
-	//@BEGIN
-	min_expo = 0.;
-	max_expo = 10;//10s
-	//@END
-	DEB_RETURN() << DEB_VAR2(min_expo, max_expo);
+	DEB_PARAM() << DEB_VAR2(nb_points, frames_per_point);
+	AutoMutex lock(m_cond.mutex());
+	if(m_acq_state == kAcqRunning)
+	{
+		THROW_HW_ERROR(Error) << "Unable to arm a step scan during an acquisition !";
+	}
+	//with a deferred commit, the trigger mode of the scan is the staged one
+	TrigMode trig_mode = m_staged_trig_mode_set ? m_staged_trig_mode : m_trigger_mode;
+	if(trig_mode != IntTrig)
+	{
+		THROW_HW_ERROR(NotSupported) << "Step scans are only available in IntTrig !";
+	}
+	if(nb_points < 1 || frames_per_point < 1)
+	{
+		THROW_HW_ERROR(InvalidValue) << "Invalid step scan : " << DEB_VAR2(nb_points, frames_per_point);
+	}
+	m_scan_nb_points = nb_points;
+	m_scan_frames_per_point = frames_per_point;
+	m_scan_points_released = 0;
+	m_scan_dead_time.reset();
+	ResetEvent(m_scan_event);
+	m_scan_armed = true;
+}
+
+//-----------------------------------------------------
+// @brief release the frames of the next point of the step scan
+//-----------------------------------------------------
+void Camera::nextPoint()
+{
+	DEB_MEMBER_FUNCT();
+	if(!m_scan_armed)
+	{
+		THROW_HW_ERROR(Error) << "No step scan armed !";
+	}
+	if(m_scan_points_released.load() >= m_scan_nb_points)
+	{
+		THROW_HW_ERROR(Error) << "All the " << m_scan_nb_points << " points of the step scan are already released !";
+	}
+	m_scan_release_time.store(CBaseTimer::now());
+	m_scan_points_released++;
+	SetEvent(m_scan_event);
 }
 
 //-----------------------------------------------------
 //
 //-----------------------------------------------------
-void Camera::getLatTimeRange(double& min_lat, double& max_lat) const
+void Camera::getScanProgress(int& nb_points_released, int& nb_points_done)
 {
 	DEB_MEMBER_FUNCT();
-	//@BEGIN
-	// --- no info on min latency
-	min_lat = 0.;
-	// --- do not know how to get the max_lat, fix it as the max exposure time
-	max_lat = 10;//10s
-	//@END
-	DEB_RETURN() << DEB_VAR2(min_lat, max_lat);
+	nb_points_released = m_scan_points_released.load();
+	nb_points_done = m_acq_frame_nb / m_scan_frames_per_point;
+	DEB_RETURN() << DEB_VAR2(nb_points_released, nb_points_done);
 }
 
 //-----------------------------------------------------
 //
 //-----------------------------------------------------
-void Camera::setNbFrames(int nb_frames)
+void Camera::getScanDeadTime(int& count, double& p50, double& p99, double& max_dead_time)
 {
 	DEB_MEMBER_FUNCT();
-	DEB_TRACE() << "setNbFrames() " << DEB_VAR1(nb_frames);
-	//@BEGIN
-	if(nb_frames < 0)
+	count = m_scan_dead_time.getCount();
+	p50 = m_scan_dead_time.getPercentile(50);
+	p99 = m_scan_dead_time.getPercentile(99);
+	max_dead_time = m_scan_dead_time.getMax();
+	DEB_RETURN() << DEB_VAR4(count, p50, p99, max_dead_time);
+}
+
+//-----------------------------------------------------
+// @brief in deferred commit mode the acquisition setters only stage their value for the next prepareAcq
+//-----------------------------------------------------
+void Camera::setDeferredCommit(bool enable)
+{
+	DEB_MEMBER_FUNCT();
+	DEB_PARAM() << DEB_VAR1(enable);
+	//the staged values are committed with m_cond locked, as in prepareAcq
+	AutoMutex lock(m_cond.mutex());
+	if(m_acq_state == kAcqRunning || m_acq_state == kAcqStopping)
 	{
-		THROW_HW_ERROR(Error) << "Number of frames to acquire has not been set";
+		THROW_HW_ERROR(Error) << "Unable to change the deferred commit mode while acquisition is running !";
 	}
-	if(nb_frames > 1)
+	m_deferred_commit = enable;
+	if(!enable)
 	{
-		//THROW_HW_ERROR(Error) << "Unable to acquire more than 1 frame ! ";	//T@D@ allowed only for test 
+		//nothing must stay staged once the setters write directly again
+		commitConfig();
 	}
-	//@END
-	m_nb_frames = nb_frames;
 }
 
 //-----------------------------------------------------
 //
 //-----------------------------------------------------
-void Camera::getNbFrames(int& nb_frames)
+void Camera::getDeferredCommit(bool& enable)
+{
+	DEB_MEMBER_FUNCT();
+	enable = m_deferred_commit;
+	DEB_RETURN() << DEB_VAR1(enable);
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void Camera::getCommitLog(std::vector<std::string>& log, double& commit_time)
+{
+	DEB_MEMBER_FUNCT();
+	log = m_commit_log;
+	commit_time = m_commit_time;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void Camera::getDroppedFrames(int& nb_dropped, int& nb_duplicated)
 {
 	DEB_MEMBER_FUNCT();
-	DEB_RETURN() << DEB_VAR1(m_nb_frames);
-	//@BEGIN
-	//@END
-	nb_frames = m_nb_frames;
+	nb_dropped = m_nb_dropped_frames;
+	nb_duplicated = m_nb_duplicated_frames;
+	DEB_RETURN() << DEB_VAR2(nb_dropped, nb_duplicated);
 }
 
 //-----------------------------------------------------
 //
 //-----------------------------------------------------
-int Camera::getNbHwAcquiredFrames()
+void Camera::resetDroppedFrames()
 {
 	DEB_MEMBER_FUNCT();
-	return m_acq_frame_nb;
+	m_nb_dropped_frames = 0;
+	m_nb_duplicated_frames = 0;
 }
 
 //-----------------------------------------------------
-// @brief range the binning to the maximum allowed
+//
 //-----------------------------------------------------
-void Camera::checkBin(Bin &hw_bin)
+void Camera::getFrameGaps(std::vector<FrameGap>& gaps)
 {
 	DEB_MEMBER_FUNCT();
-
-	//@BEGIN : check available values of binning H/V
-	int x = hw_bin.getX();
-	int y = hw_bin.getY();
-	if(x != 1 || y != 1)
-	{
-		DEB_ERROR() << "Binning values not supported";
-		THROW_HW_ERROR(Error) << "Binning values not supported = " << DEB_VAR1(hw_bin);
-	}
-	//@END
-
-	hw_bin = Bin(x, y);
-	DEB_RETURN() << DEB_VAR1(hw_bin);
+	AutoMutex gaps_lock(m_frame_gaps_lock);
+	gaps = m_frame_gaps;
 }
+
 //-----------------------------------------------------
-// @brief set the new binning mode
+//
 //-----------------------------------------------------
-void Camera::setBin(const Bin &set_bin)
+void Camera::setFillDroppedFrames(bool enable)
 {
 	DEB_MEMBER_FUNCT();
-
-	//@BEGIN : set binning H/V to the Driver/API
-	//...
-	//@END
-	m_bin = set_bin;
-
-	DEB_RETURN() << DEB_VAR1(set_bin);
+	DEB_PARAM() << DEB_VAR1(enable);
+	m_fill_dropped_frames = enable;
 }
 
 //-----------------------------------------------------
-// @brief return the current binning mode
+//
 //-----------------------------------------------------
-void Camera::getBin(Bin &hw_bin)
+void Camera::getFillDroppedFrames(bool& enable)
 {
 	DEB_MEMBER_FUNCT();
-
-	//@BEGIN : get binning from Driver/API
-	int bin_x = 1;
-	int bin_y = 1;
-	//@END
-	Bin tmp_bin(bin_x, bin_y);
-
-	hw_bin = tmp_bin;
-	m_bin = tmp_bin;
-
-	DEB_RETURN() << DEB_VAR1(hw_bin);
+	enable = m_fill_dropped_frames;
+	DEB_RETURN() << DEB_VAR1(enable);
 }
 
 //-----------------------------------------------------
-//! Camera::checkRoi()
+// @brief nb of TUCAM frames stacked in each Lima frame
 //-----------------------------------------------------
-void Camera::checkRoi(const Roi& set_roi, Roi& hw_roi)
+void Camera::setNbStackedFrames(int nb_frames)
 {
 	DEB_MEMBER_FUNCT();
-	DEB_TRACE() << "checkRoi";
-	DEB_PARAM() << DEB_VAR1(set_roi);
-	//@BEGIN : check available values of Roi
-	if(set_roi.isActive())
+	DEB_PARAM() << DEB_VAR1(nb_frames);
+	AutoMutex lock(m_cond.mutex());
+	if(nb_frames < 1)
 	{
-		hw_roi = set_roi;
+		THROW_HW_ERROR(InvalidValue) << "Invalid number of stacked frames : " << DEB_VAR1(nb_frames);
 	}
-	else
+	if(m_acq_state == kAcqRunning)
 	{
-		hw_roi = set_roi;
+		THROW_HW_ERROR(Error) << "Unable to change the number of stacked frames while acquisition is running !";
 	}
-	//@END
-
-
-	DEB_RETURN() << DEB_VAR1(hw_roi);
+	if(nb_frames == m_nb_stacked_frames)
+		return;
+	m_nb_stacked_frames = nb_frames;
+	lock.unlock();
+
+	//the Lima image size changes with the number of stacked frames
+	Size size;
+	getMaxImageSize(size);
+	ImageType type;
+	getImageType(type);
+	maxImageSizeChanged(size, type);
 }
 
-//---------------------------------------------------------------------------------------
-//! Camera::getRoi()
-//---------------------------------------------------------------------------------------
-void Camera::getRoi(Roi& hw_roi)
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void Camera::getNbStackedFrames(int& nb_frames)
 {
 	DEB_MEMBER_FUNCT();
-	//@BEGIN : get Roi from the Driver/API
-	TUCAM_ROI_ATTR roiAttr;
-	if(TUCAMRET_SUCCESS != TUCAM_Cap_GetROI(m_opCam.hIdxTUCam, &roiAttr))
-	{
-		THROW_HW_ERROR(Error) << "Unable to GetRoi from  the camera !";
-	}
-	hw_roi = Roi(roiAttr.nHOffset,
-				roiAttr.nVOffset,
-				roiAttr.nWidth,
-				roiAttr.nHeight);
-	//@END
-
-	DEB_RETURN() << DEB_VAR1(hw_roi);
+	nb_frames = m_nb_stacked_frames;
+	DEB_RETURN() << DEB_VAR1(nb_frames);
 }
 
-//---------------------------------------------------------------------------------------
-//! Camera::setRoi()
-//---------------------------------------------------------------------------------------
-void Camera::setRoi(const Roi& set_roi)
+//-----------------------------------------------------
+// @brief TUCAM frames stacked in a Lima frame of the last acquisition
+//-----------------------------------------------------
+void Camera::getSubFrames(int acq_frame_nb, std::vector<SubFrame>& sub_frames)
 {
 	DEB_MEMBER_FUNCT();
-	DEB_TRACE() << "setRoi";
-	DEB_PARAM() << DEB_VAR1(set_roi);
-	//@BEGIN : set Roi from the Driver/API	
-	if(!set_roi.isActive())
+	DEB_PARAM() << DEB_VAR1(acq_frame_nb);
+	if(acq_frame_nb < 0)
 	{
-		DEB_TRACE() << "Roi is not Enabled : so set full frame";
-
-		//set Roi to Driver/API
-		Size size;
-		getDetectorImageSize(size);
-		TUCAM_ROI_ATTR roiAttr;
-		roiAttr.bEnable = TRUE;
-		roiAttr.nHOffset = 0;
-		roiAttr.nVOffset = 0;
-		roiAttr.nWidth = size.getWidth();
-		roiAttr.nHeight = size.getHeight();
-
-		if(TUCAMRET_SUCCESS != TUCAM_Cap_SetROI(m_opCam.hIdxTUCam, roiAttr))
-		{
-			THROW_HW_ERROR(Error) << "Unable to SetRoi to the camera !";
-		}
-
+		THROW_HW_ERROR(InvalidValue) << "Invalid frame number : " << DEB_VAR1(acq_frame_nb);
 	}
-	else
+	AutoMutex lock(m_cond.mutex());
+	sub_frames.clear();
+	if(m_nb_stacked_frames <= 1)
+		return;
+	int nb_sub_frames = m_nb_sub_frames.load(std::memory_order_acquire);
+	int first = acq_frame_nb * m_nb_stacked_frames;
+	for(int i = first; i < first + m_nb_stacked_frames && i < nb_sub_frames; i++)
 	{
-		DEB_TRACE() << "Roi is Enabled";
-		//set Roi to Driver/API
-		TUCAM_ROI_ATTR roiAttr;
-		roiAttr.bEnable = TRUE;
-		roiAttr.nHOffset = set_roi.getTopLeft().x;
-		roiAttr.nVOffset = set_roi.getTopLeft().y;
-		roiAttr.nWidth = set_roi.getSize().getWidth();
-		roiAttr.nHeight = set_roi.getSize().getHeight();
-
-		if(TUCAMRET_SUCCESS != TUCAM_Cap_SetROI(m_opCam.hIdxTUCam, roiAttr))
-		{
-			THROW_HW_ERROR(Error) << "Unable to SetRoi to the camera !";
-		}
+		sub_frames.push_back(m_sub_frames[i]);
 	}
-	//@END	
 }
 
 //-----------------------------------------------------
 //
 //-----------------------------------------------------
-bool Camera::isAcqRunning() const
+void Camera::getTriggerJitter(std::vector<double>& jitter)
 {
 	DEB_MEMBER_FUNCT();
-	//	AutoMutex aLock(m_cond.mutex());
-	DEB_TRACE() << "isAcqRunning - " << DEB_VAR1(m_thread_running) << "---------------------------";
-	return m_thread_running;
+	m_internal_trigger_timer->getJitter(jitter);
 }
 
-///////////////////////////////////////////////////////
-// Dhyana specific stuff now
-///////////////////////////////////////////////////////
-
 //-----------------------------------------------------
 //
-//-----------------------------------------------------  
-void Camera::setTemperatureTarget(double temp)
+//-----------------------------------------------------
+void Camera::getTriggerJitterStats(int& nb_triggers, int& nb_missed, double& mean_jitter, double& max_jitter)
 {
 	DEB_MEMBER_FUNCT();
-	TUCAM_PROP_ATTR attrProp;
-	attrProp.nIdxChn = 0;// Current channel (camera monochrome = 0) . VERY IMPORTANT, doesn't work otherwise !!!!!
-	attrProp.idProp = TUIDP_TEMPERATURE;
-	if(TUCAMRET_SUCCESS != TUCAM_Prop_GetAttr(m_opCam.hIdxTUCam, &attrProp))
-	{
-		THROW_HW_ERROR(Error) << "Unable to Read TUIDP_TEMPERATURE range from the camera !";
-	}
-	DEB_TRACE() << "Temperature range [" << (int) attrProp.dbValMin << " , " << (int) attrProp.dbValMax << "]";
-
-	int temp_middle = (int) attrProp.dbValMax / 2;
-	if(((int) temp + temp_middle)<((int) attrProp.dbValMin) || ((int) temp + temp_middle)>((int) attrProp.dbValMax))
-	{
-		THROW_HW_ERROR(Error) << "Unable to set the Temperature Target !\n"
-		 << "It is out of range : "
-		 << "["
-		 << (int) attrProp.dbValMin - temp_middle
-		 << ","
-		 << (int) attrProp.dbValMax - temp_middle
-		 << "]";
-	}
-
-	int nVal = (int) temp + temp_middle;//temperatureTarget is a delta according to the middle temperature !!
-	if(TUCAMRET_SUCCESS != TUCAM_Prop_SetValue(m_opCam.hIdxTUCam, TUIDP_TEMPERATURE, nVal))
-	{
-		THROW_HW_ERROR(Error) << "Unable to Write TUIDP_TEMPERATURE to the camera !";
-	}
-	m_temperature_target = (double) temp;
+	m_internal_trigger_timer->getJitterStats(nb_triggers, nb_missed, mean_jitter, max_jitter);
 }
 
 //-----------------------------------------------------
 //
-//-----------------------------------------------------  
-void Camera::getTemperatureTarget(double& temp)
+//-----------------------------------------------------
+void Camera::getLatencyStats(LatencyStage stage, int& count, double& p50, double& p99, double& max_latency)
 {
 	DEB_MEMBER_FUNCT();
-
-	temp = m_temperature_target;
+	DEB_PARAM() << DEB_VAR1(stage);
+	if(stage < 0 || stage >= kNbLatencyStages)
+	{
+		THROW_HW_ERROR(InvalidValue) << "Invalid latency stage : " << DEB_VAR1(stage);
+	}
+	const LatencyHistogram& histogram = m_latency[stage];
+	count = histogram.getCount();
+	p50 = histogram.getPercentile(50);
+	p99 = histogram.getPercentile(99);
+	max_latency = histogram.getMax();
+	DEB_RETURN() << DEB_VAR4(count, p50, p99, max_latency);
 }
 
 //-----------------------------------------------------
 //
-//-----------------------------------------------------  
-void Camera::getTemperature(double& temp)
+//-----------------------------------------------------
+void Camera::getLatencyHistogram(LatencyStage stage, std::vector<double>& bounds, std::vector<int>& counts)
 {
 	DEB_MEMBER_FUNCT();
-
-	double dbVal = 0.0f;
-	if(TUCAMRET_SUCCESS != TUCAM_Prop_GetValue(m_opCam.hIdxTUCam, TUIDP_TEMPERATURE, &dbVal))
+	DEB_PARAM() << DEB_VAR1(stage);
+	if(stage < 0 || stage >= kNbLatencyStages)
 	{
-		THROW_HW_ERROR(Error) << "Unable to Read TUIDP_TEMPERATURE from the camera !";
+		THROW_HW_ERROR(InvalidValue) << "Invalid latency stage : " << DEB_VAR1(stage);
 	}
-	temp = dbVal;
+	m_latency[stage].getBuckets(bounds, counts);
 }
 
 //-----------------------------------------------------
 //
-//-----------------------------------------------------  
-void Camera::setFanSpeed(unsigned speed)
+//-----------------------------------------------------
+void Camera::getTriggerTimestamps(std::vector<double>& timestamps)
 {
 	DEB_MEMBER_FUNCT();
-
-	int nVal = (int) speed;
-
-	if(TUCAMRET_SUCCESS != TUCAM_Capa_SetValue(m_opCam.hIdxTUCam, TUIDC_FAN_GEAR, nVal))
+	AutoMutex trigger_lock(m_trigger_times_lock);
+	timestamps.resize(m_trigger_times.size());
+	for(size_t i = 0; i < m_trigger_times.size(); i++)
 	{
-		THROW_HW_ERROR(Error) << "Unable to Write TUIDC_FAN_GEAR to the camera !";
+		timestamps[i] = m_trigger_times[i] - m_acq_start_time;
 	}
 }
 
 //-----------------------------------------------------
-//
-//-----------------------------------------------------  
-void Camera::getFanSpeed(unsigned& speed)
+// @brief state of the acquisition control
+//-----------------------------------------------------
+void Camera::getAcqState(AcqState& state)
 {
 	DEB_MEMBER_FUNCT();
-
-	int nVal;
-	if(TUCAMRET_SUCCESS != TUCAM_Capa_GetValue(m_opCam.hIdxTUCam, TUIDC_FAN_GEAR, &nVal))
-	{
-		THROW_HW_ERROR(Error) << "Unable to Read TUIDC_FAN_GEAR from the camera !";
-	}
-	speed = (unsigned) nVal;
+	state = m_acq_state;
+	DEB_RETURN() << DEB_VAR1(state);
 }
 
 //-----------------------------------------------------
-//
-//-----------------------------------------------------  
-void Camera::setGlobalGain(unsigned gain)
+// @brief durations of the transitions into a state of the acquisition control
+//-----------------------------------------------------
+void Camera::getTransitionStats(AcqState state, int& count, double& p50, double& p99, double& max_latency)
 {
 	DEB_MEMBER_FUNCT();
-
-	if(gain != 0 && gain != 1 && gain != 2)
+	DEB_PARAM() << DEB_VAR1(state);
+	if(state < 0 || state >= kNbAcqStates)
 	{
-		THROW_HW_ERROR(Error) << "Available gain values are : 0:HDR\n1:HIGH\n2: LOW !";
+		THROW_HW_ERROR(InvalidValue) << "Invalid acquisition state : " << DEB_VAR1(state);
 	}
+	const LatencyHistogram& histogram = m_transition_latency[state];
+	count = histogram.getCount();
+	p50 = histogram.getPercentile(50);
+	p99 = histogram.getPercentile(99);
+	max_latency = histogram.getMax();
+	DEB_RETURN() << DEB_VAR4(count, p50, p99, max_latency);
+}
 
-	double dbVal = (double) gain;
-	if(TUCAMRET_SUCCESS != TUCAM_Prop_SetValue(m_opCam.hIdxTUCam, TUIDP_GLOBALGAIN, dbVal))
-	{
-		THROW_HW_ERROR(Error) << "Unable to Write TUIDP_GLOBALGAIN to the camera !";
-	}
+//-----------------------------------------------------
+// @brief watchdog timeout of TUCAM_Buf_WaitForFrame (0 = auto, < 0 = disabled)
+//-----------------------------------------------------
+void Camera::setWatchdogTimeout(double timeout)
+{
+	DEB_MEMBER_FUNCT();
+	DEB_PARAM() << DEB_VAR1(timeout);
+	m_watchdog_timeout = timeout;
 }
 
 //-----------------------------------------------------
 //
-//-----------------------------------------------------  
-void Camera::getGlobalGain(unsigned& gain)
+//-----------------------------------------------------
+void Camera::getWatchdogTimeout(double& timeout)
 {
 	DEB_MEMBER_FUNCT();
-
-	double dbVal;
-	if(TUCAMRET_SUCCESS != TUCAM_Prop_GetValue(m_opCam.hIdxTUCam, TUIDP_GLOBALGAIN, &dbVal))
-	{
-		THROW_HW_ERROR(Error) << "Unable to Read TUIDP_GLOBALGAIN from the camera !";
-	}
-	gain = (unsigned) dbVal;
+	timeout = m_watchdog_timeout;
+	DEB_RETURN() << DEB_VAR1(timeout);
 }
 
 //-----------------------------------------------------
-//
+// @brief restarts of the capture done by the watchdog
 //-----------------------------------------------------
-void Camera::getTucamVersion(std::string& version)
+void Camera::getWatchdogStats(int& nb_recoveries, int& nb_failures, double& p50_recovery_time, double& max_recovery_time)
 {
 	DEB_MEMBER_FUNCT();
-	TUCAM_VALUE_INFO valInfo;
-	valInfo.nID = TUIDI_VERSION_API;
-	if(TUCAMRET_SUCCESS != TUCAM_Dev_GetInfo(m_opCam.hIdxTUCam, &valInfo))
+	nb_recoveries = m_nb_recoveries;
+	nb_failures = m_nb_recovery_failures;
+	p50_recovery_time = m_recovery_time.getPercentile(50);
+	max_recovery_time = m_recovery_time.getMax();
+	DEB_RETURN() << DEB_VAR4(nb_recoveries, nb_failures, p50_recovery_time, max_recovery_time);
+}
+
+//-----------------------------------------------------
+// @brief watchdog timeout of the acquisition to start, 0 if disabled
+//-----------------------------------------------------
+double Camera::computeWatchdogTimeout()
+{
+	//a zero-copy capture can not be restarted, its reservation holds the frames given to Lima
+	if(m_watchdog_timeout < 0 || m_zero_copy)
+		return 0.0;
+	if(m_watchdog_timeout > 0)
+		return m_watchdog_timeout;
+
+	//an external trigger may never come, only IntTrig has a known period
+	if(m_trigger_mode != IntTrig)
+		return 0.0;
+	double period = m_exp_time + m_lat_time;
+	if(m_capture_mode == TUCCM_TRIGGER_SOFTWARE && m_int_trigger_mode == kIntTrigTimer && !m_scan_armed)
 	{
-		THROW_HW_ERROR(Error) << "Unable to Read TUIDI_VERSION_API from the camera !";
+		period = m_internal_trigger_timer->getPeriod();
 	}
-	version = valInfo.pText;
+	return max(WATCHDOG_PERIOD_FACTOR * period, WATCHDOG_MIN_TIMEOUT);
 }
 
 //-----------------------------------------------------
-//
-//-----------------------------------------------------  
-void Camera::getFirmwareVersion(std::string& version)
+// @brief called by the watchdog timer : abort a TUCAM_Buf_WaitForFrame lasting more than the timeout
+//-----------------------------------------------------
+void Camera::checkWatchdog()
+{
+	double wait_start = m_frame_wait_start;
+	if(wait_start == 0.0 || m_watchdog_fired || m_acq_state != kAcqRunning)
+		return;
+	if(CBaseTimer::now() - wait_start < m_watchdog_timeout_used)
+		return;
+	m_watchdog_fired = true;
+	TUCAM_Buf_AbortWait(m_opCam.hIdxTUCam);
+}
+
+//-----------------------------------------------------
+// @brief restart the capture from the AcqThread, without m_cond locked, false if it can not be restarted
+//-----------------------------------------------------
+bool Camera::recoverCapture()
 {
 	DEB_MEMBER_FUNCT();
-	TUCAM_VALUE_INFO valInfo;
-	valInfo.nID = TUIDI_VERSION_FRMW;
-	if(TUCAMRET_SUCCESS != TUCAM_Dev_GetInfo(m_opCam.hIdxTUCam, &valInfo))
+	double t0 = CBaseTimer::now();
+	DEB_WARNING() << "No frame within " << m_watchdog_timeout_used << " s, restart the capture";
+
+	//in zero-copy the frames already given to Lima point into the reservation, it can not be released
+	if(m_zero_copy)
 	{
-		THROW_HW_ERROR(Error) << "Unable to Read TUIDI_VERSION_FRMW from the camera !";
+		m_nb_recovery_failures++;
+		DEB_ERROR() << "Unable to restart the capture in zero-copy mode !";
+		return false;
 	}
-	version = valInfo.nValue;
-}
 
-//-----------------------------------------------------------------------------
-/// Get the frame rate
-//-----------------------------------------------------------------------------
-void Camera::getFPS(double& fps) ///< [out] last computed fps
-{
-    DEB_MEMBER_FUNCT();
+	//the TUCAM buffers can only be released once the DispatchThread is done with them
+	while(m_frame_queue.size() > 0 && m_acq_state == kAcqRunning)
+	{
+		WaitForSingleObject(m_frame_free_event, DISPATCH_POLL_MS);
+	}
+
+	//stopAcq and the setters only touch the capture with m_cond locked
+	AutoMutex lock(m_cond.mutex());
+	if(m_acq_state != kAcqRunning)
+	{
+		//stopped meanwhile, the capture is released by the stop
+		m_watchdog_fired = false;
+		return true;
+	}
+
+	DEB_TRACE() << "TUCAM_Cap_Stop";
+	TUCAM_Cap_Stop(m_opCam.hIdxTUCam);
+	DEB_TRACE() << "TUCAM_Buf_Release";
+	TUCAM_Buf_Release(m_opCam.hIdxTUCam);
+	m_sdk_buffer_allocated = false;
+
+	m_frame.pBuffer = NULL;
+	m_frame.ucFormatGet = TUFRM_FMT_RAW;
+	m_frame.uiRsdSize = m_sdk_buffer_depth_used;
+	DEB_TRACE() << "TUCAM_Buf_Alloc";
+	bool restarted;
+	{
+		CpuTopology::ScopedBinding binding(m_acq_cpus);
+		restarted = (TUCAMRET_SUCCESS == TUCAM_Buf_Alloc(m_opCam.hIdxTUCam, &m_frame));
+	}
+	if(restarted)
+	{
+		m_sdk_buffer_allocated = true;
+		DEB_TRACE() << "TUCAM_Cap_Start";
+		restarted = (TUCAMRET_SUCCESS == TUCAM_Cap_Start(m_opCam.hIdxTUCam, m_capture_mode));
+	}
+
+	//the TUCAM frame index starts again with the capture
+	m_nb_armed_triggers = 0;
+	m_nb_armed_frames = 0;
+	m_hw_index_valid = false;
+	m_watchdog_fired = false;
 
-    fps = m_fps;
+	double recovery_time = CBaseTimer::now() - t0;
+	if(!restarted)
+	{
+		m_nb_recovery_failures++;
+		DEB_ERROR() << "Unable to restart the capture !";
+		return false;
+	}
+	m_nb_recoveries++;
+	m_recovery_time.add(recovery_time);
+	DEB_TRACE() << "Capture restarted in " << recovery_time * 1000 << " ms";
+	return true;
 }
 
 //-----------------------------------------------------
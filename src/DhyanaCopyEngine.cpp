@@ -0,0 +1,252 @@
+//###########################################################################
+// This file is part of LImA, a Library for Image Acquisition
+//
+// Copyright (C) : 2009-2014
+// European Synchrotron Radiation Facility
+// BP 220, Grenoble 38043
+// FRANCE
+//
+// This is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This software is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//###########################################################################
+
+#include <string.h>
+#include <algorithm>
+#include "lima/Exceptions.h"
+#include "DhyanaCopyKernel.h"
+#include "DhyanaCopyEngine.h"
+#include "DhyanaTopology.h"
+
+using namespace lima;
+using namespace lima::Dhyana;
+using namespace std;
+
+//---------------------------
+// @brief  Ctor
+//---------------------------
+CopyEngine::CopyEngine(int nb_threads, const std::vector<int>& cpus):
+m_quit(false),
+m_job_id(0),
+m_nb_done(0),
+m_dst(NULL),
+m_src(NULL),
+m_src_stride(0),
+m_row_size(0),
+m_nb_rows(0),
+m_binning(false),
+m_dst_depth(16),
+m_width(0),
+m_bin_x(1),
+m_bin_y(1)
+{
+	DEB_CONSTRUCTOR();
+	DEB_PARAM() << DEB_VAR1(nb_threads);
+
+	//all the cpus when the workers are not bound to a NUMA node
+	std::vector<int> worker_cpus = cpus;
+	for(int cpu = 0; cpus.empty() && cpu < CpuTopology::getNbCpus(); cpu++)
+	{
+		worker_cpus.push_back(cpu);
+	}
+
+	//the first cpu is left to the system and to the acquisition threads
+	int nb_cpus = (int) worker_cpus.size();
+	for(int i = 0; i < nb_threads; i++)
+	{
+		int cpu = worker_cpus[(nb_cpus > 1) ? 1 + (i % (nb_cpus - 1)) : 0];
+		DEB_TRACE() << "Create copy worker " << i << " on cpu " << cpu;
+		Worker* worker = new Worker(*this, i + 1, cpu);
+		m_workers.push_back(worker);
+		worker->start();
+	}
+}
+
+//---------------------------
+// @brief  Dtor
+//---------------------------
+CopyEngine::~CopyEngine()
+{
+	DEB_DESTRUCTOR();
+	AutoMutex aLock(m_cond.mutex());
+	m_quit = true;
+	m_cond.broadcast();
+	aLock.unlock();
+
+	for(size_t i = 0; i < m_workers.size(); i++)
+	{
+		delete m_workers[i];
+	}
+}
+
+//---------------------------
+//
+//---------------------------
+int CopyEngine::getNbThreads() const
+{
+	return (int) m_workers.size();
+}
+
+//---------------------------
+// @brief copy a frame of nb_rows rows, the calling thread copies the first stripe
+//---------------------------
+void CopyEngine::copy(void* dst, const void* src, size_t src_stride, size_t row_size, int nb_rows)
+{
+	if(m_workers.empty() || row_size * nb_rows < COPY_ENGINE_MIN_SIZE || nb_rows <= (int) m_workers.size())
+	{
+		CopyKernel::copyRows(dst, src, src_stride, row_size, nb_rows);
+		return;
+	}
+
+	AutoMutex aLock(m_cond.mutex());
+	m_binning = false;
+	m_dst = (unsigned char*) dst;
+	m_src = (const unsigned char*) src;
+	m_src_stride = src_stride;
+	m_row_size = row_size;
+	m_nb_rows = nb_rows;
+	aLock.unlock();
+	run();
+}
+
+//---------------------------
+// @brief bin a frame, the calling thread bins the first stripe
+//---------------------------
+void CopyEngine::bin(void* dst, int dst_depth, const void* src, size_t src_stride, int width, int height, int bin_x, int bin_y)
+{
+	int nb_rows = height / bin_y;
+	if(m_workers.empty() || (size_t) width * height * 2 < COPY_ENGINE_MIN_SIZE || nb_rows <= (int) m_workers.size())
+	{
+		CopyKernel::bin(dst, dst_depth, src, src_stride, width, height, bin_x, bin_y);
+		return;
+	}
+
+	AutoMutex aLock(m_cond.mutex());
+	m_binning = true;
+	m_dst = (unsigned char*) dst;
+	m_src = (const unsigned char*) src;
+	m_src_stride = src_stride;
+	m_dst_depth = dst_depth;
+	m_width = width;
+	m_bin_x = bin_x;
+	m_bin_y = bin_y;
+	m_nb_rows = nb_rows;
+	aLock.unlock();
+	run();
+}
+
+//---------------------------
+// @brief start the workers on the current frame, do the first stripe and wait for the others
+//---------------------------
+void CopyEngine::run()
+{
+	AutoMutex aLock(m_cond.mutex());
+	m_nb_done = 0;
+	m_job_id++;
+	m_cond.broadcast();
+	aLock.unlock();
+
+	m_binning ? binStripe(0) : copyStripe(0);
+
+	aLock.lock();
+	while(m_nb_done < (int) m_workers.size())
+	{
+		m_cond.wait();
+	}
+}
+
+//---------------------------
+// @brief copy the rows of one stripe
+//---------------------------
+void CopyEngine::copyStripe(int stripe)
+{
+	int nb_stripes = (int) m_workers.size() + 1;
+	int rows_per_stripe = (m_nb_rows + nb_stripes - 1) / nb_stripes;
+	int begin = min(stripe * rows_per_stripe, m_nb_rows);
+	int end = (stripe == nb_stripes - 1) ? m_nb_rows : min((stripe + 1) * rows_per_stripe, m_nb_rows);
+	if(end > begin)
+	{
+		CopyKernel::copyRows(m_dst + (size_t) begin * m_row_size, m_src + (size_t) begin * m_src_stride, m_src_stride, m_row_size, end - begin);
+	}
+}
+
+//---------------------------
+// @brief bin the dst rows of one stripe, each dst row is made of m_bin_y src rows
+//---------------------------
+void CopyEngine::binStripe(int stripe)
+{
+	int nb_stripes = (int) m_workers.size() + 1;
+	int rows_per_stripe = (m_nb_rows + nb_stripes - 1) / nb_stripes;
+	int begin = min(stripe * rows_per_stripe, m_nb_rows);
+	int end = (stripe == nb_stripes - 1) ? m_nb_rows : min((stripe + 1) * rows_per_stripe, m_nb_rows);
+	if(end > begin)
+	{
+		size_t dst_row_size = (size_t) (m_width / m_bin_x) * (m_dst_depth / 8);
+		CopyKernel::bin(m_dst + begin * dst_row_size, m_dst_depth, m_src + (size_t) begin * m_bin_y * m_src_stride, m_src_stride,
+						m_width, (end - begin) * m_bin_y, m_bin_x, m_bin_y);
+	}
+}
+
+//---------------------------
+// @brief  Ctor
+//---------------------------
+CopyEngine::Worker::Worker(CopyEngine& engine, int stripe, int cpu):
+m_engine(engine),
+m_stripe(stripe),
+m_cpu(cpu),
+m_job_id(0)
+{
+	AutoMutex aLock(m_engine.m_cond.mutex());
+	m_job_id = m_engine.m_job_id;
+	aLock.unlock();
+	pthread_attr_setscope(&m_thread_attr, PTHREAD_SCOPE_PROCESS);
+}
+
+//---------------------------
+// @brief  Dtor
+//---------------------------
+CopyEngine::Worker::~Worker()
+{
+	join();
+}
+
+//---------------------------
+//
+//---------------------------
+void CopyEngine::Worker::threadFunction()
+{
+	DEB_MEMBER_FUNCT();
+	if(!CpuTopology::bindCurrentThread(std::vector<int>(1, m_cpu)))
+	{
+		DEB_WARNING() << "Unable to pin copy worker on cpu " << m_cpu;
+	}
+
+	AutoMutex aLock(m_engine.m_cond.mutex());
+	while(true)
+	{
+		while(m_job_id == m_engine.m_job_id && !m_engine.m_quit)
+		{
+			m_engine.m_cond.wait();
+		}
+		if(m_engine.m_quit)
+			return;
+
+		m_job_id = m_engine.m_job_id;
+		bool binning = m_engine.m_binning;
+		aLock.unlock();
+		binning ? m_engine.binStripe(m_stripe) : m_engine.copyStripe(m_stripe);
+		aLock.lock();
+
+		m_engine.m_nb_done++;
+		m_engine.m_cond.broadcast();
+	}
+}
@@ -0,0 +1,432 @@
+//###########################################################################
+// This file is part of LImA, a Library for Image Acquisition
+//
+// Copyright (C) : 2009-2014
+// European Synchrotron Radiation Facility
+// BP 220, Grenoble 38043
+// FRANCE
+//
+// This is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This software is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//###########################################################################
+
+#include <string.h>
+#include <vector>
+#include "DhyanaCopyKernel.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define DHYANA_X86
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#include <immintrin.h>
+#endif
+
+// gcc only emits the intrinsics of an instruction set inside functions targeting it
+#if defined(__GNUC__)
+#define DHYANA_TARGET(isa) __attribute__((target(isa)))
+#else
+#define DHYANA_TARGET(isa)
+#endif
+
+// AVX-512 intrinsics are available since Visual Studio 2017
+#if defined(DHYANA_X86) && (!defined(_MSC_VER) || _MSC_VER >= 1910)
+#define DHYANA_AVX512
+#endif
+
+using namespace lima;
+using namespace lima::Dhyana;
+
+typedef void (*CopyFunc)(void* dst, const void* src, size_t size);
+typedef void (*SumRowFunc)(unsigned* acc, const unsigned short* src, int width, bool first);
+typedef void (*StoreRowFunc)(void* dst, int dst_depth, const unsigned* acc, int width, int bin_x);
+
+//---------------------------
+// @brief add a row of pixels to the row accumulator (set it for the first row)
+//---------------------------
+static void sumRow(unsigned* acc, const unsigned short* src, int width, bool first)
+{
+	for(int x = 0; x < width; x++)
+	{
+		acc[x] = (first ? 0 : acc[x]) + src[x];
+	}
+}
+
+//---------------------------
+// @brief sum bin_x accumulators into each pixel of dst, saturated to the pixel depth
+//---------------------------
+static void storeRow(void* dst, int dst_depth, const unsigned* acc, int width, int bin_x)
+{
+	int out_width = width / bin_x;
+	for(int x = 0; x < out_width; x++, acc += bin_x)
+	{
+		unsigned long long sum = 0;
+		for(int i = 0; i < bin_x; i++)
+		{
+			sum += acc[i];
+		}
+		if(dst_depth == 16)
+			((unsigned short*) dst)[x] = (unsigned short) ((sum > 0xFFFF) ? 0xFFFF : sum);
+		else
+			((unsigned*) dst)[x] = (unsigned) ((sum > 0xFFFFFFFF) ? 0xFFFFFFFF : sum);
+	}
+}
+
+#ifdef DHYANA_X86
+
+//---------------------------
+// @brief cpuid / xgetbv wrappers
+//---------------------------
+static void cpuid(int info[4], int leaf, int subleaf)
+{
+#ifdef _MSC_VER
+	__cpuidex(info, leaf, subleaf);
+#else
+	unsigned int a, b, c, d;
+	__cpuid_count(leaf, subleaf, a, b, c, d);
+	info[0] = a; info[1] = b; info[2] = c; info[3] = d;
+#endif
+}
+
+static unsigned long long xgetbv0()
+{
+#ifdef _MSC_VER
+	return _xgetbv(0);
+#else
+	unsigned int eax, edx;
+	__asm__ __volatile__("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+	return ((unsigned long long) edx << 32) | eax;
+#endif
+}
+
+//---------------------------
+// @brief copy the bytes up to the first address of dst aligned on align,
+// returns the number of bytes copied
+//---------------------------
+static size_t copyHead(unsigned char* dst, const unsigned char* src, size_t size, size_t align)
+{
+	size_t head = (align - ((size_t) dst & (align - 1))) & (align - 1);
+	if(head > size)
+		head = size;
+	memcpy(dst, src, head);
+	return head;
+}
+
+//---------------------------
+//
+//---------------------------
+static void copySSE2(void* dst, const void* src, size_t size)
+{
+	unsigned char* d = (unsigned char*) dst;
+	const unsigned char* s = (const unsigned char*) src;
+	size_t head = copyHead(d, s, size, 16);
+	d += head; s += head; size -= head;
+
+	size_t nb_blocks = size / 64;
+	for(size_t i = 0; i < nb_blocks; i++, d += 64, s += 64)
+	{
+		__m128i r0 = _mm_loadu_si128((const __m128i*) (s));
+		__m128i r1 = _mm_loadu_si128((const __m128i*) (s + 16));
+		__m128i r2 = _mm_loadu_si128((const __m128i*) (s + 32));
+		__m128i r3 = _mm_loadu_si128((const __m128i*) (s + 48));
+		_mm_stream_si128((__m128i*) (d), r0);
+		_mm_stream_si128((__m128i*) (d + 16), r1);
+		_mm_stream_si128((__m128i*) (d + 32), r2);
+		_mm_stream_si128((__m128i*) (d + 48), r3);
+	}
+	_mm_sfence();
+	memcpy(d, s, size % 64);
+}
+
+//---------------------------
+//
+//---------------------------
+DHYANA_TARGET("avx2")
+static void copyAVX2(void* dst, const void* src, size_t size)
+{
+	unsigned char* d = (unsigned char*) dst;
+	const unsigned char* s = (const unsigned char*) src;
+	size_t head = copyHead(d, s, size, 32);
+	d += head; s += head; size -= head;
+
+	size_t nb_blocks = size / 128;
+	for(size_t i = 0; i < nb_blocks; i++, d += 128, s += 128)
+	{
+		__m256i r0 = _mm256_loadu_si256((const __m256i*) (s));
+		__m256i r1 = _mm256_loadu_si256((const __m256i*) (s + 32));
+		__m256i r2 = _mm256_loadu_si256((const __m256i*) (s + 64));
+		__m256i r3 = _mm256_loadu_si256((const __m256i*) (s + 96));
+		_mm256_stream_si256((__m256i*) (d), r0);
+		_mm256_stream_si256((__m256i*) (d + 32), r1);
+		_mm256_stream_si256((__m256i*) (d + 64), r2);
+		_mm256_stream_si256((__m256i*) (d + 96), r3);
+	}
+	_mm_sfence();
+	_mm256_zeroupper();
+	memcpy(d, s, size % 128);
+}
+
+//---------------------------
+// @brief sumRow, 16 pixels at a time widened to 32 bits
+//---------------------------
+DHYANA_TARGET("avx2")
+static void sumRowAVX2(unsigned* acc, const unsigned short* src, int width, bool first)
+{
+	int x = 0;
+	for(; x + 16 <= width; x += 16)
+	{
+		__m256i pixels = _mm256_loadu_si256((const __m256i*) (src + x));
+		__m256i lo = _mm256_cvtepu16_epi32(_mm256_castsi256_si128(pixels));
+		__m256i hi = _mm256_cvtepu16_epi32(_mm256_extracti128_si256(pixels, 1));
+		if(!first)
+		{
+			lo = _mm256_add_epi32(lo, _mm256_loadu_si256((const __m256i*) (acc + x)));
+			hi = _mm256_add_epi32(hi, _mm256_loadu_si256((const __m256i*) (acc + x + 8)));
+		}
+		_mm256_storeu_si256((__m256i*) (acc + x), lo);
+		_mm256_storeu_si256((__m256i*) (acc + x + 8), hi);
+	}
+	_mm256_zeroupper();
+	sumRow(acc + x, src + x, width - x, first);
+}
+
+//---------------------------
+// @brief storeRow, vectorised for the 1 and 2 horizontal factors
+// (a sum of 2 x 2048 rows of 16 bits pixels can not overflow 32 bits)
+//---------------------------
+DHYANA_TARGET("avx2")
+static void storeRowAVX2(void* dst, int dst_depth, const unsigned* acc, int width, int bin_x)
+{
+	if(bin_x > 2)
+	{
+		storeRow(dst, dst_depth, acc, width, bin_x);
+		return;
+	}
+	int out_width = width / bin_x;
+	const __m256i max16 = _mm256_set1_epi32(0xFFFF);
+	int x = 0;
+	for(; x + 16 <= out_width; x += 16)
+	{
+		const unsigned* a = acc + x * bin_x;
+		__m256i lo, hi;
+		if(bin_x == 1)
+		{
+			lo = _mm256_loadu_si256((const __m256i*) (a));
+			hi = _mm256_loadu_si256((const __m256i*) (a + 8));
+		}
+		else
+		{
+			// hadd works within 128 bits lanes, put the sums back in order
+			lo = _mm256_hadd_epi32(_mm256_loadu_si256((const __m256i*) (a)), _mm256_loadu_si256((const __m256i*) (a + 8)));
+			hi = _mm256_hadd_epi32(_mm256_loadu_si256((const __m256i*) (a + 16)), _mm256_loadu_si256((const __m256i*) (a + 24)));
+			lo = _mm256_permute4x64_epi64(lo, 0xD8);
+			hi = _mm256_permute4x64_epi64(hi, 0xD8);
+		}
+		if(dst_depth == 16)
+		{
+			lo = _mm256_min_epu32(lo, max16);
+			hi = _mm256_min_epu32(hi, max16);
+			__m256i pixels = _mm256_permute4x64_epi64(_mm256_packus_epi32(lo, hi), 0xD8);
+			_mm256_storeu_si256((__m256i*) ((unsigned short*) dst + x), pixels);
+		}
+		else
+		{
+			_mm256_storeu_si256((__m256i*) ((unsigned*) dst + x), lo);
+			_mm256_storeu_si256((__m256i*) ((unsigned*) dst + x + 8), hi);
+		}
+	}
+	_mm256_zeroupper();
+	void* dst_tail = (dst_depth == 16) ? (void*) ((unsigned short*) dst + x) : (void*) ((unsigned*) dst + x);
+	storeRow(dst_tail, dst_depth, acc + x * bin_x, (out_width - x) * bin_x, bin_x);
+}
+
+#ifdef DHYANA_AVX512
+//---------------------------
+//
+//---------------------------
+DHYANA_TARGET("avx512f")
+static void copyAVX512(void* dst, const void* src, size_t size)
+{
+	unsigned char* d = (unsigned char*) dst;
+	const unsigned char* s = (const unsigned char*) src;
+	size_t head = copyHead(d, s, size, 64);
+	d += head; s += head; size -= head;
+
+	size_t nb_blocks = size / 256;
+	for(size_t i = 0; i < nb_blocks; i++, d += 256, s += 256)
+	{
+		__m512i r0 = _mm512_loadu_si512((const void*) (s));
+		__m512i r1 = _mm512_loadu_si512((const void*) (s + 64));
+		__m512i r2 = _mm512_loadu_si512((const void*) (s + 128));
+		__m512i r3 = _mm512_loadu_si512((const void*) (s + 192));
+		_mm512_stream_si512((__m512i*) (d), r0);
+		_mm512_stream_si512((__m512i*) (d + 64), r1);
+		_mm512_stream_si512((__m512i*) (d + 128), r2);
+		_mm512_stream_si512((__m512i*) (d + 192), r3);
+	}
+	_mm_sfence();
+	memcpy(d, s, size % 256);
+}
+#endif
+
+#endif // DHYANA_X86
+
+//---------------------------
+//
+//---------------------------
+static void copyMemcpy(void* dst, const void* src, size_t size)
+{
+	memcpy(dst, src, size);
+}
+
+//---------------------------
+// @brief select the kernel once, when the library is loaded
+//---------------------------
+static const CopyKernel::Type s_kernel_type = CopyKernel::detect();
+
+static CopyFunc selectCopyFunc(CopyKernel::Type type)
+{
+	switch(type)
+	{
+#ifdef DHYANA_X86
+#ifdef DHYANA_AVX512
+		case CopyKernel::kAVX512: return copyAVX512;
+#endif
+		case CopyKernel::kAVX2:   return copyAVX2;
+		case CopyKernel::kSSE2:   return copySSE2;
+#endif
+		default:                  return copyMemcpy;
+	}
+}
+
+static const CopyFunc s_copy_func = selectCopyFunc(s_kernel_type);
+
+#ifdef DHYANA_X86
+static const bool s_bin_avx2 = (s_kernel_type == CopyKernel::kAVX2 || s_kernel_type == CopyKernel::kAVX512);
+static const SumRowFunc s_sum_row_func = s_bin_avx2 ? sumRowAVX2 : sumRow;
+static const StoreRowFunc s_store_row_func = s_bin_avx2 ? storeRowAVX2 : storeRow;
+#else
+static const SumRowFunc s_sum_row_func = sumRow;
+static const StoreRowFunc s_store_row_func = storeRow;
+#endif
+
+//---------------------------
+// @brief find the widest instruction set supported by both the cpu and the OS
+//---------------------------
+CopyKernel::Type CopyKernel::detect()
+{
+#ifdef DHYANA_X86
+	int info[4];
+	cpuid(info, 0, 0);
+	int max_leaf = info[0];
+
+	cpuid(info, 1, 0);
+	bool sse2 = (info[3] & (1 << 26)) != 0;
+	bool osxsave = (info[2] & (1 << 27)) != 0;
+	unsigned long long xcr0 = osxsave ? xgetbv0() : 0;
+
+	int ebx7 = 0;
+	if(max_leaf >= 7)
+	{
+		cpuid(info, 7, 0);
+		ebx7 = info[1];
+	}
+
+#ifdef DHYANA_AVX512
+	// OS must save XMM, YMM, opmask and ZMM states
+	if((ebx7 & (1 << 16)) && (xcr0 & 0xE6) == 0xE6)
+		return kAVX512;
+#endif
+	// OS must save XMM and YMM states
+	if((ebx7 & (1 << 5)) && (xcr0 & 0x6) == 0x6)
+		return kAVX2;
+	if(sse2)
+		return kSSE2;
+#endif
+	return kMemcpy;
+}
+
+//---------------------------
+//
+//---------------------------
+CopyKernel::Type CopyKernel::getType()
+{
+	return s_kernel_type;
+}
+
+//---------------------------
+//
+//---------------------------
+const char* CopyKernel::getName()
+{
+	switch(s_kernel_type)
+	{
+		case kAVX512: return "AVX-512 streaming stores";
+		case kAVX2:   return "AVX2 streaming stores";
+		case kSSE2:   return "SSE2 streaming stores";
+		default:      return "memcpy";
+	}
+}
+
+//---------------------------
+// @brief copy size bytes, bypassing the caches for large copies
+//---------------------------
+void CopyKernel::copy(void* dst, const void* src, size_t size)
+{
+	if(size < COPY_KERNEL_MIN_STREAM_SIZE)
+	{
+		memcpy(dst, src, size);
+		return;
+	}
+	s_copy_func(dst, src, size);
+}
+
+//---------------------------
+// @brief rows padded in src are copied one at a time
+//---------------------------
+void CopyKernel::copyRows(void* dst, const void* src, size_t src_stride, size_t row_size, int nb_rows)
+{
+	if(src_stride == row_size)
+	{
+		copy(dst, src, row_size * nb_rows);
+		return;
+	}
+	unsigned char* d = (unsigned char*) dst;
+	const unsigned char* s = (const unsigned char*) src;
+	for(int y = 0; y < nb_rows; y++, d += row_size, s += src_stride)
+	{
+		copy(d, s, row_size);
+	}
+}
+
+//---------------------------
+// @brief sum the rows of each block in a 32 bits accumulator, then the columns into dst
+//---------------------------
+void CopyKernel::bin(void* dst, int dst_depth, const void* src, size_t src_stride, int width, int height, int bin_x, int bin_y)
+{
+	int out_width = width / bin_x;
+	size_t out_row_size = (size_t) out_width * (dst_depth / 8);
+	std::vector<unsigned> acc(width);
+	unsigned char* d = (unsigned char*) dst;
+	const unsigned char* s = (const unsigned char*) src;
+	for(int y = 0; y + bin_y <= height; y += bin_y, d += out_row_size)
+	{
+		for(int i = 0; i < bin_y; i++, s += src_stride)
+		{
+			s_sum_row_func(&acc[0], (const unsigned short*) s, width, i == 0);
+		}
+		s_store_row_func(d, dst_depth, &acc[0], out_width * bin_x, bin_x);
+	}
+}
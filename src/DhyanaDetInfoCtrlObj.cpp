@@ -48,7 +48,7 @@ DetInfoCtrlObj::~DetInfoCtrlObj()
 void DetInfoCtrlObj::getMaxImageSize(Size& size)
 {
 	DEB_MEMBER_FUNCT();
-	m_cam.getDetectorImageSize(size);
+	m_cam.getMaxImageSize(size);
 }
 
 //-----------------------------------------------------
@@ -57,7 +57,7 @@ void DetInfoCtrlObj::getMaxImageSize(Size& size)
 void DetInfoCtrlObj::getDetectorImageSize(Size& image_size)
 {
 	DEB_MEMBER_FUNCT();
-	getMaxImageSize(image_size);
+	m_cam.getDetectorImageSize(image_size);
 }
 
 //-----------------------------------------------------
@@ -66,7 +66,8 @@ void DetInfoCtrlObj::getDetectorImageSize(Size& image_size)
 void DetInfoCtrlObj::getDefImageType(ImageType& image_type)
 {
 	DEB_MEMBER_FUNCT();
-	m_cam.getImageType(image_type);
+	//pixels of the sensor, Bpp32 is only a software conversion
+	image_type = Bpp16;
 }
 
 //-----------------------------------------------------
@@ -120,7 +121,7 @@ void DetInfoCtrlObj::getDetectorModel(std::string& model)
 void DetInfoCtrlObj::registerMaxImageSizeCallback(HwMaxImageSizeCallback& cb)
 {
 	DEB_MEMBER_FUNCT();
-	//m_cam.registerMaxImageSizeCallback(cb);
+	m_cam.registerMaxImageSizeCallback(cb);
 }
 
 //-----------------------------------------------------
@@ -129,6 +130,6 @@ void DetInfoCtrlObj::registerMaxImageSizeCallback(HwMaxImageSizeCallback& cb)
 void DetInfoCtrlObj::unregisterMaxImageSizeCallback(HwMaxImageSizeCallback& cb)
 {
 	DEB_MEMBER_FUNCT();
-	//m_cam.unregisterMaxImageSizeCallback(cb);
+	m_cam.unregisterMaxImageSizeCallback(cb);
 }
 
@@ -0,0 +1,250 @@
+//###########################################################################
+// This file is part of LImA, a Library for Image Acquisition
+//
+// Copyright (C) : 2009-2014
+// European Synchrotron Radiation Facility
+// BP 220, Grenoble 38043
+// FRANCE
+//
+// This is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This software is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//###########################################################################
+
+#include "DhyanaFrameRate.h"
+
+using namespace lima;
+using namespace lima::Dhyana;
+using namespace std;
+
+//---------------------------
+// @brief  Ctor
+//---------------------------
+FrameRateMeter::FrameRateMeter():
+m_times(FRAME_RATE_MAX_SAMPLES)
+{
+	reset(0.0);
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void FrameRateMeter::reset(double expected_period, double stall_factor)
+{
+	AutoMutex aLock(m_lock);
+	m_stopped = false;
+	m_expected_period = expected_period;
+	m_stall_factor = stall_factor;
+	m_first = 0;
+	m_nb_times = 0;
+	m_nb_frames = 0;
+	m_start_time = 0.0;
+	m_last_time = 0.0;
+	m_ewma_period = 0.0;
+
+	m_instant_rate.store(0.0, memory_order_relaxed);
+	m_min_window_rate.store(0.0, memory_order_relaxed);
+	m_average_rate.store(0.0, memory_order_relaxed);
+	m_nb_stalls.store(0, memory_order_relaxed);
+	m_max_gap.store(0.0, memory_order_relaxed);
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void FrameRateMeter::add(double frame_time)
+{
+	AutoMutex aLock(m_lock);
+	double period = 0.0;
+	m_nb_frames++;
+	if(m_nb_frames == 1)
+	{
+		m_start_time = frame_time;
+	}
+	else
+	{
+		period = frame_time - m_last_time;
+		m_ewma_period = (m_nb_frames == 2) ? period : m_ewma_period + FRAME_RATE_EWMA_ALPHA * (period - m_ewma_period);
+		if(m_ewma_period > 0)
+		{
+			m_instant_rate.store(1. / m_ewma_period, memory_order_relaxed);
+		}
+
+		//the average is only a reference once a few frames have been seen
+		double expected_period = (m_expected_period > 0) ? m_expected_period : m_ewma_period;
+		if(m_nb_frames > 2 && period > m_stall_factor * expected_period)
+		{
+			m_nb_stalls.store(m_nb_stalls.load(memory_order_relaxed) + 1, memory_order_relaxed);
+		}
+		if(period > m_max_gap.load(memory_order_relaxed))
+		{
+			m_max_gap.store(period, memory_order_relaxed);
+		}
+		m_average_rate.store((m_nb_frames - 1) / (frame_time - m_start_time), memory_order_relaxed);
+	}
+	m_last_time = frame_time;
+
+	//slide the window
+	if(m_nb_times == FRAME_RATE_MAX_SAMPLES)
+	{
+		m_first = (m_first + 1) % FRAME_RATE_MAX_SAMPLES;
+		m_nb_times--;
+	}
+	m_times[(m_first + m_nb_times) % FRAME_RATE_MAX_SAMPLES] = frame_time;
+	m_nb_times++;
+
+	bool full_window = false;
+	while(m_nb_times > 1 && frame_time - m_times[m_first] > FRAME_RATE_WINDOW)
+	{
+		m_first = (m_first + 1) % FRAME_RATE_MAX_SAMPLES;
+		m_nb_times--;
+		full_window = true;
+	}
+
+	//after a gap longer than the window only the last frame is left : one frame over the gap
+	double window_rate = 0.0;
+	if(m_nb_times > 1)
+	{
+		window_rate = (m_nb_times - 1) / (frame_time - m_times[m_first]);
+	}
+	else if(m_nb_frames > 1)
+	{
+		window_rate = 1. / period;
+	}
+
+	double min_rate = m_min_window_rate.load(memory_order_relaxed);
+	if(full_window && (min_rate == 0.0 || window_rate < min_rate))
+	{
+		m_min_window_rate.store(window_rate, memory_order_relaxed);
+	}
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void FrameRateMeter::stop()
+{
+	AutoMutex aLock(m_lock);
+	m_stopped = true;
+}
+
+//-----------------------------------------------------
+// @brief time at which the results are given, m_lock must be held
+//-----------------------------------------------------
+double FrameRateMeter::getReadTime(double now) const
+{
+	if(m_stopped || now < m_last_time)
+		return m_last_time;
+	return now;
+}
+
+//-----------------------------------------------------
+// @brief no frame for longer than a stall since the last one, m_lock must be held
+//-----------------------------------------------------
+bool FrameRateMeter::isStalled(double now) const
+{
+	//same rule as in add() for the gap that is still going on
+	if(m_nb_frames < 2)
+		return false;
+	double expected_period = (m_expected_period > 0) ? m_expected_period : m_ewma_period;
+	return getReadTime(now) - m_last_time > m_stall_factor * expected_period;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+double FrameRateMeter::getInstantRate() const
+{
+	return m_instant_rate.load(memory_order_relaxed);
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+double FrameRateMeter::getWindowRate(double now) const
+{
+	AutoMutex aLock(m_lock);
+	if(m_nb_frames == 0)
+		return 0.0;
+
+	//frames within ]t - FRAME_RATE_WINDOW, t]
+	double t = getReadTime(now);
+	int nb_frames = 0;
+	double oldest_time = t;
+	for(int i = m_nb_times - 1; i >= 0; i--)
+	{
+		double frame_time = m_times[(m_first + i) % FRAME_RATE_MAX_SAMPLES];
+		if(t - frame_time >= FRAME_RATE_WINDOW)
+			break;
+		nb_frames++;
+		oldest_time = frame_time;
+	}
+
+	//the window is not covered yet (start of the acquisition, or more frames than samples) : rate between its frames
+	bool partial_window = (t - m_start_time < FRAME_RATE_WINDOW) || (nb_frames == FRAME_RATE_MAX_SAMPLES);
+	if(partial_window)
+	{
+		return (nb_frames > 1 && t > oldest_time) ? (nb_frames - 1) / (t - oldest_time) : 0.0;
+	}
+	return nb_frames / FRAME_RATE_WINDOW;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+double FrameRateMeter::getMinWindowRate() const
+{
+	return m_min_window_rate.load(memory_order_relaxed);
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+double FrameRateMeter::getAverageRate() const
+{
+	return m_average_rate.load(memory_order_relaxed);
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+int FrameRateMeter::getNbStalls(double now) const
+{
+	AutoMutex aLock(m_lock);
+	//the current gap is only counted by add() once its frame comes
+	return m_nb_stalls.load(memory_order_relaxed) + (isStalled(now) ? 1 : 0);
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+double FrameRateMeter::getMaxGap(double now) const
+{
+	AutoMutex aLock(m_lock);
+	double max_gap = m_max_gap.load(memory_order_relaxed);
+	if(m_nb_frames > 0 && getReadTime(now) - m_last_time > max_gap)
+	{
+		max_gap = getReadTime(now) - m_last_time;
+	}
+	return max_gap;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+double FrameRateMeter::getTimeSinceLastFrame(double now) const
+{
+	AutoMutex aLock(m_lock);
+	if(m_nb_frames == 0)
+		return 0.0;
+	return getReadTime(now) - m_last_time;
+}
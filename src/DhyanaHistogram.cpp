@@ -0,0 +1,156 @@
+//###########################################################################
+// This file is part of LImA, a Library for Image Acquisition
+//
+// Copyright (C) : 2009-2014
+// European Synchrotron Radiation Facility
+// BP 220, Grenoble 38043
+// FRANCE
+//
+// This is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This software is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//###########################################################################
+
+#include <math.h>
+#include "DhyanaHistogram.h"
+
+using namespace lima;
+using namespace lima::Dhyana;
+using namespace std;
+
+//---------------------------
+// @brief  Ctor
+//---------------------------
+LatencyHistogram::LatencyHistogram()
+{
+	reset();
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void LatencyHistogram::reset()
+{
+	for(int i = 0; i < HISTOGRAM_NB_BUCKETS; i++)
+	{
+		m_counts[i].store(0, memory_order_relaxed);
+	}
+	m_count.store(0, memory_order_relaxed);
+	m_max.store(0.0, memory_order_relaxed);
+}
+
+//-----------------------------------------------------
+// @brief bucket of a duration, 1/HISTOGRAM_BUCKETS_PER_OCTAVE of its octave wide
+//-----------------------------------------------------
+int LatencyHistogram::getBucket(double duration)
+{
+	if(duration <= HISTOGRAM_MIN_TIME)
+		return 0;
+
+	//duration / HISTOGRAM_MIN_TIME = mantissa * 2^exponent with mantissa in [0.5, 1[
+	int exponent;
+	double mantissa = frexp(duration / HISTOGRAM_MIN_TIME, &exponent);
+	int bucket = (exponent - 1) * HISTOGRAM_BUCKETS_PER_OCTAVE
+				 + (int) ((mantissa * 2 - 1) * HISTOGRAM_BUCKETS_PER_OCTAVE) + 1;
+	return (bucket < HISTOGRAM_NB_BUCKETS) ? bucket : HISTOGRAM_NB_BUCKETS - 1;
+}
+
+//-----------------------------------------------------
+// @brief upper bound (s) of a bucket
+//-----------------------------------------------------
+double LatencyHistogram::getBucketBound(int bucket)
+{
+	if(bucket <= 0)
+		return HISTOGRAM_MIN_TIME;
+
+	int exponent = (bucket - 1) / HISTOGRAM_BUCKETS_PER_OCTAVE;
+	int step = (bucket - 1) % HISTOGRAM_BUCKETS_PER_OCTAVE + 1;
+	return ldexp(HISTOGRAM_MIN_TIME * (1. + (double) step / HISTOGRAM_BUCKETS_PER_OCTAVE), exponent);
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void LatencyHistogram::add(double duration)
+{
+	int bucket = getBucket(duration);
+	//single writer : no read-modify-write needed
+	m_counts[bucket].store(m_counts[bucket].load(memory_order_relaxed) + 1, memory_order_relaxed);
+	if(duration > m_max.load(memory_order_relaxed))
+	{
+		m_max.store(duration, memory_order_relaxed);
+	}
+	m_count.store(m_count.load(memory_order_relaxed) + 1, memory_order_release);
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+int LatencyHistogram::getCount() const
+{
+	return m_count.load(memory_order_acquire);
+}
+
+//-----------------------------------------------------
+// @brief upper bound of the bucket holding the given percentile (0-100)
+//-----------------------------------------------------
+double LatencyHistogram::getPercentile(double percent) const
+{
+	int count = getCount();
+	if(count == 0)
+		return 0.0;
+
+	//rank of the percentile, 1-based
+	int rank = (int) ceil(percent / 100. * count);
+	if(rank < 1)
+		rank = 1;
+
+	int sum = 0;
+	for(int i = 0; i < HISTOGRAM_NB_BUCKETS; i++)
+	{
+		sum += m_counts[i].load(memory_order_relaxed);
+		if(sum >= rank)
+		{
+			//never report more than the largest duration actually seen
+			double bound = getBucketBound(i);
+			double max_duration = getMax();
+			return (bound < max_duration) ? bound : max_duration;
+		}
+	}
+	return getMax();
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+double LatencyHistogram::getMax() const
+{
+	return m_max.load(memory_order_relaxed);
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void LatencyHistogram::getBuckets(std::vector<double>& bounds, std::vector<int>& counts) const
+{
+	bounds.clear();
+	counts.clear();
+	for(int i = 0; i < HISTOGRAM_NB_BUCKETS; i++)
+	{
+		int count = m_counts[i].load(memory_order_relaxed);
+		if(count)
+		{
+			bounds.push_back(getBucketBound(i));
+			counts.push_back(count);
+		}
+	}
+}
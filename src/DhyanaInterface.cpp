@@ -81,10 +81,11 @@ void Interface::reset(ResetLevel reset_level)
 
 	m_cam.reset();
 
+	//size the buffers from the roi and the image type of the camera, not from the full sensor
 	Size image_size;
-	m_det_info.getMaxImageSize(image_size);
+	m_cam.getImageSize(image_size);
 	ImageType image_type;
-	m_det_info.getDefImageType(image_type);
+	m_det_info.getCurrImageType(image_type);
 	FrameDim frame_dim(image_size, image_type);
 
 	HwBufferCtrlObj *buffer = m_cam.getBufferCtrlObj();
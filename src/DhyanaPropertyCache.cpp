@@ -0,0 +1,237 @@
+//###########################################################################
+// This file is part of LImA, a Library for Image Acquisition
+//
+// Copyright (C) : 2009-2014
+// European Synchrotron Radiation Facility
+// BP 220, Grenoble 38043
+// FRANCE
+//
+// This is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This software is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//###########################################################################
+
+#include "DhyanaPropertyCache.h"
+
+using namespace lima;
+using namespace lima::Dhyana;
+using namespace std;
+
+//---------------------------
+// @brief  Ctor
+//---------------------------
+PropertyCache::PropertyCache():
+m_handle(NULL),
+m_verify(false),
+m_roi_valid(false),
+m_nb_hits(0),
+m_nb_misses(0),
+m_nb_mismatches(0)
+{
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void PropertyCache::setHandle(HDTUCAM handle)
+{
+	AutoMutex lock(m_lock);
+	m_handle = handle;
+	m_props.clear();
+	m_capas.clear();
+	m_roi_valid = false;
+}
+
+//-----------------------------------------------------
+// @brief forget all the cached values
+//-----------------------------------------------------
+void PropertyCache::invalidate()
+{
+	DEB_MEMBER_FUNCT();
+	AutoMutex lock(m_lock);
+	m_props.clear();
+	m_capas.clear();
+	m_roi_valid = false;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void PropertyCache::setVerify(bool verify)
+{
+	AutoMutex lock(m_lock);
+	m_verify = verify;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+bool PropertyCache::getVerify() const
+{
+	AutoMutex lock(m_lock);
+	return m_verify;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void PropertyCache::getStats(int& nb_hits, int& nb_misses, int& nb_mismatches) const
+{
+	AutoMutex lock(m_lock);
+	nb_hits = m_nb_hits;
+	nb_misses = m_nb_misses;
+	nb_mismatches = m_nb_mismatches;
+}
+
+//-----------------------------------------------------
+// @brief TUCAM_Prop_GetValue through the cache
+//-----------------------------------------------------
+TUCAMRET PropertyCache::getProp(int id, double& value)
+{
+	DEB_MEMBER_FUNCT();
+	AutoMutex lock(m_lock);
+	map<int, double>::iterator it = m_props.find(id);
+	if(it != m_props.end() && !m_verify)
+	{
+		m_nb_hits++;
+		value = it->second;
+		return TUCAMRET_SUCCESS;
+	}
+
+	TUCAMRET ret = TUCAM_Prop_GetValue(m_handle, id, &value);
+	if(TUCAMRET_SUCCESS != ret)
+		return ret;
+
+	if(it == m_props.end())
+	{
+		m_nb_misses++;
+		m_props[id] = value;
+	}
+	else
+	{
+		if(it->second != value)
+		{
+			DEB_WARNING() << "TUCAM property " << id << " changed behind the cache : " << it->second << " -> " << value;
+			m_nb_mismatches++;
+		}
+		it->second = value;
+	}
+	return ret;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+TUCAMRET PropertyCache::setProp(int id, double value)
+{
+	AutoMutex lock(m_lock);
+	//the camera may round the value : it is read back on the next get
+	m_props.erase(id);
+	return TUCAM_Prop_SetValue(m_handle, id, value);
+}
+
+//-----------------------------------------------------
+// @brief TUCAM_Capa_GetValue through the cache
+//-----------------------------------------------------
+TUCAMRET PropertyCache::getCapa(int id, int& value)
+{
+	DEB_MEMBER_FUNCT();
+	AutoMutex lock(m_lock);
+	map<int, int>::iterator it = m_capas.find(id);
+	if(it != m_capas.end() && !m_verify)
+	{
+		m_nb_hits++;
+		value = it->second;
+		return TUCAMRET_SUCCESS;
+	}
+
+	INT32 nVal = 0;
+	TUCAMRET ret = TUCAM_Capa_GetValue(m_handle, id, &nVal);
+	if(TUCAMRET_SUCCESS != ret)
+		return ret;
+	value = nVal;
+
+	if(it == m_capas.end())
+	{
+		m_nb_misses++;
+		m_capas[id] = value;
+	}
+	else
+	{
+		if(it->second != value)
+		{
+			DEB_WARNING() << "TUCAM capability " << id << " changed behind the cache : " << it->second << " -> " << value;
+			m_nb_mismatches++;
+		}
+		it->second = value;
+	}
+	return ret;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+TUCAMRET PropertyCache::setCapa(int id, int value)
+{
+	AutoMutex lock(m_lock);
+	//a capability may change the sensor readout : the roi and all the properties are read again
+	m_capas.clear();
+	m_props.clear();
+	m_roi_valid = false;
+	return TUCAM_Capa_SetValue(m_handle, id, value);
+}
+
+//-----------------------------------------------------
+// @brief TUCAM_Cap_GetROI through the cache
+//-----------------------------------------------------
+TUCAMRET PropertyCache::getRoi(TUCAM_ROI_ATTR& roi)
+{
+	DEB_MEMBER_FUNCT();
+	AutoMutex lock(m_lock);
+	if(m_roi_valid && !m_verify)
+	{
+		m_nb_hits++;
+		roi = m_roi;
+		return TUCAMRET_SUCCESS;
+	}
+
+	TUCAMRET ret = TUCAM_Cap_GetROI(m_handle, &roi);
+	if(TUCAMRET_SUCCESS != ret)
+		return ret;
+
+	if(!m_roi_valid)
+	{
+		m_nb_misses++;
+	}
+	else if(m_roi.nHOffset != roi.nHOffset || m_roi.nVOffset != roi.nVOffset ||
+			m_roi.nWidth != roi.nWidth || m_roi.nHeight != roi.nHeight)
+	{
+		DEB_WARNING() << "TUCAM roi changed behind the cache";
+		m_nb_mismatches++;
+	}
+	m_roi = roi;
+	m_roi_valid = true;
+	return ret;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+TUCAMRET PropertyCache::setRoi(const TUCAM_ROI_ATTR& roi)
+{
+	AutoMutex lock(m_lock);
+	//the camera aligns the roi : it is read back on the next get,
+	//the properties as well since their limits (e.g. the exposure) depend on the readout
+	m_roi_valid = false;
+	m_props.clear();
+	return TUCAM_Cap_SetROI(m_handle, roi);
+}
@@ -26,6 +26,48 @@
 
 using namespace lima;
 using namespace lima::Dhyana;
+
+//-----------------------------------------------------
+// @brief roi of one TUCAM frame from a roi of the stacked image
+//-----------------------------------------------------
+static Roi toFrameRoi(const Roi& stacked_roi, int nb_stacked_frames)
+{
+	Point top_left = stacked_roi.getTopLeft();
+	Size size = stacked_roi.getSize();
+	int height = (size.getHeight() + nb_stacked_frames - 1) / nb_stacked_frames;
+	return Roi(top_left.x, top_left.y, size.getWidth(), height);
+}
+
+//-----------------------------------------------------
+// @brief roi of the stacked image from the roi of one TUCAM frame
+//-----------------------------------------------------
+static Roi toStackedRoi(const Roi& frame_roi, int nb_stacked_frames)
+{
+	Point top_left = frame_roi.getTopLeft();
+	Size size = frame_roi.getSize();
+	return Roi(top_left.x, top_left.y, size.getWidth(), size.getHeight() * nb_stacked_frames);
+}
+
+//-----------------------------------------------------
+// @brief roi in TUCAM pixels from a roi in binned pixels (as given by Lima),
+//        bin is the part of the binning done in software
+//-----------------------------------------------------
+static Roi toSensorRoi(const Roi& binned_roi, const Bin& bin)
+{
+	Point top_left = binned_roi.getTopLeft();
+	Size size = binned_roi.getSize();
+	return Roi(top_left.x * bin.getX(), top_left.y * bin.getY(), size.getWidth() * bin.getX(), size.getHeight() * bin.getY());
+}
+
+//-----------------------------------------------------
+// @brief roi in binned pixels from a roi in TUCAM pixels
+//-----------------------------------------------------
+static Roi toBinnedRoi(const Roi& sensor_roi, const Bin& bin)
+{
+	Point top_left = sensor_roi.getTopLeft();
+	Size size = sensor_roi.getSize();
+	return Roi(top_left.x / bin.getX(), top_left.y / bin.getY(), size.getWidth() / bin.getX(), size.getHeight() / bin.getY());
+}
 /*******************************************************************
  * \brief RoiCtrlObj constructor
  *******************************************************************/
@@ -50,7 +92,28 @@ RoiCtrlObj::~RoiCtrlObj()
 void RoiCtrlObj::checkRoi(const Roi& set_roi, Roi& hw_roi)
 {
 	DEB_MEMBER_FUNCT();
-	m_cam.checkRoi(set_roi, hw_roi);
+	int nb_stacked_frames;
+	m_cam.getNbStackedFrames(nb_stacked_frames);
+	Bin hw_bin, bin;
+	m_cam.getBinSplit(hw_bin, bin);
+	if(!set_roi.isActive())
+	{
+		m_cam.checkRoi(set_roi, hw_roi);
+		return;
+	}
+	//the roi is given in binned pixels on the stacked image, check the roi of one TUCAM frame
+	//(TUCAM pixels are already binned by the resolution mode)
+	Roi frame_roi = toSensorRoi(toFrameRoi(set_roi, nb_stacked_frames), bin);
+	Size size;
+	m_cam.getResolutionSize(size);
+	if(nb_stacked_frames > 1 && frame_roi.getBottomRight().y >= size.getHeight())
+	{
+		//the roi spans several stacked frames : take them whole, the rest is done by the Lima software roi
+		frame_roi = Roi(frame_roi.getTopLeft().x, 0, frame_roi.getSize().getWidth(), size.getHeight());
+	}
+	Roi hw_frame_roi;
+	m_cam.checkRoi(frame_roi, hw_frame_roi);
+	hw_roi = toStackedRoi(toBinnedRoi(hw_frame_roi, bin), nb_stacked_frames);
 }
 
 //-----------------------------------------------------
@@ -61,6 +124,14 @@ void RoiCtrlObj::setRoi(const Roi& roi)
 	DEB_MEMBER_FUNCT();
 	Roi real_roi;
 	checkRoi(roi, real_roi);
+	int nb_stacked_frames;
+	m_cam.getNbStackedFrames(nb_stacked_frames);
+	Bin hw_bin, bin;
+	m_cam.getBinSplit(hw_bin, bin);
+	if(real_roi.isActive())
+	{
+		real_roi = toSensorRoi(toFrameRoi(real_roi, nb_stacked_frames), bin);
+	}
 	m_cam.setRoi(real_roi);
 
 }
@@ -71,5 +142,11 @@ void RoiCtrlObj::setRoi(const Roi& roi)
 void RoiCtrlObj::getRoi(Roi& roi)
 {
 	DEB_MEMBER_FUNCT();
-	m_cam.getRoi(roi);
+	Roi frame_roi;
+	m_cam.getRoi(frame_roi);
+	int nb_stacked_frames;
+	m_cam.getNbStackedFrames(nb_stacked_frames);
+	Bin hw_bin, bin;
+	m_cam.getBinSplit(hw_bin, bin);
+	roi = toStackedRoi(toBinnedRoi(frame_roi, bin), nb_stacked_frames);
 }
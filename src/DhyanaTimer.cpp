@@ -29,6 +29,7 @@
 #include <signal.h>
 #include <unistd.h>
 #include <errno.h>
+#include <time.h>
 #include "lima/Exceptions.h"
 #include "lima/Debug.h"
 #include "lima/MiscUtils.h"
@@ -41,21 +42,36 @@ using namespace std;
 //---------------------------
 // @brief  ctor
 //---------------------------    
-CBaseTimer::CBaseTimer(int period) :
-m_period_ms(period),
-m_nb_triggers(-1)
+CBaseTimer::CBaseTimer(double period) :
+m_running(false),
+m_in_timer(false),
+m_quit(false),
+m_run(0),
+m_period(period),
+m_nb_triggers(0),
+m_nb_missed(0),
+m_jitter_sum(0.),
+m_jitter_max(0.),
+m_spin_time(0.)
 {
 	DEB_CONSTRUCTOR();		
-	// Set resolution to the minimum supported by the system
-    TIMECAPS tc;
-    if(timeGetDevCaps(&tc, sizeof(TIMECAPS))!=TIMERR_NOERROR)
+#ifdef WIN32
+	// high resolution waitable timers are available since Windows 10 1803,
+	// otherwise fall back to a 1 ms timer and busy wait longer before each deadline
+	m_spin_time = TIMER_SPIN_TIME;
+	m_legacy_timer = false;
+	m_timer_handle = CreateWaitableTimerEx(NULL, NULL, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+	if(m_timer_handle == NULL)
 	{
-		throw std::exception("Erreur timeGetDevCaps");
+		m_spin_time = TIMER_SPIN_TIME_LEGACY;
+		m_legacy_timer = true;
+		m_timer_handle = CreateWaitableTimer(NULL, TRUE, NULL);
+		timeBeginPeriod(1);
 	}
-    m_resolution = min(max(tc.wPeriodMin, 0), tc.wPeriodMax);
-	DEB_TRACE()<<"Timer resolution : "<< m_resolution<<" (ms)";
-	DEB_TRACE()<<"Timer period : "<< m_period_ms<<" (ms)";
-    timeBeginPeriod(m_resolution);	
+	DEB_TRACE() << "Timer busy wait : " << m_spin_time * 1000 << " (ms)";
+#endif
+	DEB_TRACE() << "Timer period : " << m_period * 1000 << " (ms)";
+	pthread_attr_setscope(&m_thread_attr, PTHREAD_SCOPE_PROCESS);
 };
 
 //---------------------------
@@ -65,32 +81,263 @@ CBaseTimer::~CBaseTimer()
 {
 	DEB_DESTRUCTOR();		
 	stop();
+	AutoMutex aLock(m_cond.mutex());
+	m_quit = true;
+	m_cond.broadcast();
+	aLock.unlock();
+	if(hasStarted())
+	{
+		join();
+	}
+#ifdef WIN32
+	if(m_legacy_timer)
+	{
+		timeEndPeriod(1);
+	}
+	CloseHandle(m_timer_handle);
+#endif
 };
 
+//---------------------------
+// @brief  monotonic clock (s)
+//---------------------------   
+double CBaseTimer::now()
+{
+#ifdef WIN32
+	static LARGE_INTEGER frequency = {0};
+	if(frequency.QuadPart == 0)
+	{
+		QueryPerformanceFrequency(&frequency);
+	}
+	LARGE_INTEGER counter;
+	QueryPerformanceCounter(&counter);
+	return (double) counter.QuadPart / frequency.QuadPart;
+#else
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+#endif
+}
+
+//---------------------------
+// @brief  period (s) between two ticks, applied at the next start() even if already running
+//---------------------------   
+void CBaseTimer::setPeriod(double period)
+{
+	DEB_MEMBER_FUNCT();
+	DEB_PARAM() << DEB_VAR1(period);
+	AutoMutex aLock(m_cond.mutex());
+	m_period = period;
+}
+
+//---------------------------
+//
+//---------------------------   
+double CBaseTimer::getPeriod() const
+{
+	AutoMutex aLock(m_cond.mutex());
+	return m_period;
+}
+
+//---------------------------
+// @brief  busy wait (s) before each deadline, trades cpu for precision
+//---------------------------   
+void CBaseTimer::setSpinTime(double spin_time)
+{
+	DEB_MEMBER_FUNCT();
+	DEB_PARAM() << DEB_VAR1(spin_time);
+	if(spin_time < 0 || spin_time > TIMER_SPIN_TIME_MAX)
+	{
+		THROW_HW_ERROR(InvalidValue) << "Timer spin time must be in [0, " << TIMER_SPIN_TIME_MAX << "] (s) !";
+	}
+	AutoMutex aLock(m_cond.mutex());
+	m_spin_time = spin_time;
+}
+
+//---------------------------
+//
+//---------------------------   
+double CBaseTimer::getSpinTime() const
+{
+	AutoMutex aLock(m_cond.mutex());
+	return m_spin_time;
+}
+
 //---------------------------
 // @brief  start
 //---------------------------   
 void CBaseTimer::start()
 {
 	DEB_MEMBER_FUNCT();
-	
-	m_nb_triggers = -1;
-	m_timer_id = timeSetEvent(m_period_ms, m_resolution, base_timer_proc, (DWORD_PTR)this, TIME_PERIODIC);
-	if (m_timer_id == NULL)
+	DEB_TRACE() << "Timer period : " << m_period * 1000 << " (ms)";
+	if(m_period <= 0)
+	{
+		THROW_HW_ERROR(InvalidValue) << "Timer period must be > 0 !";
+	}
+	// the thread is only started here so that on_timer() is never called on a partially built object
+	if(!hasStarted())
 	{
-		throw std::exception("Erreur timeSetEvent");
+		Thread::start();
 	}
+
+	AutoMutex aLock(m_cond.mutex());
+	m_nb_triggers = 0;
+	m_nb_missed = 0;
+	m_jitter_sum = 0.;
+	m_jitter_max = 0.;
+	m_jitter.clear();
+	m_running = true;
+	// a running tick loop latches the new period and starts again from now
+	m_run++;
+	m_cond.broadcast();
 }
 
 //---------------------------
-// @brief  stop
+// @brief  stop, returns once no on_timer() is in progress
 //---------------------------   
 void CBaseTimer::stop()
 {
 	DEB_MEMBER_FUNCT();
-	DEB_TRACE() << "Number of triggers generated by the Timer = "<<m_nb_triggers;
-	timeKillEvent(m_timer_id);
-	timeEndPeriod(m_resolution);
+	AutoMutex aLock(m_cond.mutex());
+	m_running = false;
+	m_cond.broadcast();
+	while(m_in_timer)
+	{
+		m_cond.wait();
+	}
+	DEB_TRACE() << "Number of triggers generated by the Timer = " << m_nb_triggers;
+}
+
+//---------------------------
+// @brief  jitter of each tick of the last run
+//---------------------------   
+void CBaseTimer::getJitter(std::vector<double>& jitter)
+{
+	DEB_MEMBER_FUNCT();
+	AutoMutex aLock(m_cond.mutex());
+	jitter = m_jitter;
+}
+
+//---------------------------
+//
+//---------------------------   
+void CBaseTimer::getJitterStats(int& nb_ticks, int& nb_missed, double& mean_jitter, double& max_jitter)
+{
+	DEB_MEMBER_FUNCT();
+	AutoMutex aLock(m_cond.mutex());
+	nb_ticks = m_nb_triggers;
+	nb_missed = m_nb_missed;
+	mean_jitter = m_nb_triggers ? m_jitter_sum / m_nb_triggers : 0.;
+	max_jitter = m_jitter_max;
+	DEB_RETURN() << DEB_VAR4(nb_ticks, nb_missed, mean_jitter, max_jitter);
+}
+
+//---------------------------
+// @brief  sleep until the deadline (monotonic clock, s), precise to the spin time if requested
+//---------------------------   
+void CBaseTimer::sleepUntil(double deadline, bool precise)
+{
+#ifdef WIN32
+	AutoMutex aLock(m_cond.mutex());
+	double spin_time = precise ? m_spin_time : 0.;
+	aLock.unlock();
+	double remaining = deadline - now();
+	if(remaining > spin_time && m_timer_handle != NULL)
+	{
+		LARGE_INTEGER due_time;
+		due_time.QuadPart = -(LONGLONG) ((remaining - spin_time) * 1e7);// relative, in 100 ns units
+		SetWaitableTimer(m_timer_handle, &due_time, 0, NULL, NULL, FALSE);
+		WaitForSingleObject(m_timer_handle, INFINITE);
+	}
+	// sub-millisecond precision : busy wait for the last part only,
+	// an early wake-up (or no timer at all) sleeps instead of spinning
+	while(precise && (remaining = deadline - now()) > 0)
+	{
+		if(remaining > spin_time)
+			Sleep(1);
+	}
+#else
+	struct timespec ts;
+	ts.tv_sec = (time_t) deadline;
+	ts.tv_nsec = (long) ((deadline - ts.tv_sec) * 1e9);
+	while(clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR)
+	{
+	}
+#endif
+}
+
+//---------------------------
+// @brief  tick on absolute deadlines while running
+//---------------------------   
+void CBaseTimer::threadFunction()
+{
+	DEB_MEMBER_FUNCT();
+	AutoMutex aLock(m_cond.mutex());
+	while(!m_quit)
+	{
+		while(!m_running && !m_quit)
+		{
+			m_cond.wait();
+		}
+		if(m_quit)
+			break;
+
+		int run = m_run;
+		double period = m_period;
+		double t0 = now();
+		long tick = 1;
+		aLock.unlock();
+
+		while(true)
+		{
+			double deadline = t0 + tick * period;
+
+			// sleep by slices so that stop() is noticed quickly whatever the period
+			double t = now();
+			while(t < deadline)
+			{
+				double wake_up = min(deadline, t + TIMER_STOP_POLL_TIME);
+				sleepUntil(wake_up, wake_up == deadline);
+				aLock.lock();
+				bool running = m_running && m_run == run;
+				aLock.unlock();
+				if(!running)
+					break;
+				t = now();
+			}
+
+			aLock.lock();
+			if(!m_running || m_quit || m_run != run)
+				break;
+			double jitter = now() - deadline;
+			m_nb_triggers++;
+			m_jitter_sum += jitter;
+			if(jitter > m_jitter_max)
+				m_jitter_max = jitter;
+			if(m_jitter.size() < TIMER_JITTER_HISTORY)
+				m_jitter.push_back(jitter);
+			m_in_timer = true;
+			aLock.unlock();
+
+			on_timer();
+
+			aLock.lock();
+			m_in_timer = false;
+			m_cond.broadcast();
+			aLock.unlock();
+
+			// never burst to catch up ticks that are already more than one period late
+			tick++;
+			long next_tick = (long) floor((now() - t0) / period) + 1;
+			if(next_tick > tick)
+			{
+				aLock.lock();
+				m_nb_missed += next_tick - tick;
+				aLock.unlock();
+				tick = next_tick;
+			}
+		}
+	}
 }
 
 /////////////////////////////
@@ -100,7 +347,7 @@ void CBaseTimer::stop()
 //---------------------------
 // @brief  ctor
 //---------------------------   
-CSoftTriggerTimer::CSoftTriggerTimer(int period, Camera& cam) :
+CSoftTriggerTimer::CSoftTriggerTimer(double period, Camera& cam) :
 CBaseTimer(period),
 m_cam(cam)
 {
@@ -113,6 +360,8 @@ m_cam(cam)
 CSoftTriggerTimer::~CSoftTriggerTimer()
 {
 	DEB_DESTRUCTOR();	
+	// on_timer() must not be called any more once this object is destroyed
+	stop();
 };
 
 //---------------------------
@@ -121,20 +370,35 @@ CSoftTriggerTimer::~CSoftTriggerTimer()
 void CSoftTriggerTimer::on_timer()
 {
 	DEB_MEMBER_FUNCT();
-	//std::cout << "-------------------" << std::endl;
-	//Generate software trigger for each frame, except for the first image
-	//if((!m_cam.m_nb_frames || m_cam.m_acq_frame_nb < m_cam.m_nb_frames) && (m_cam.m_trigger_mode == IntTrig))
-	{
-		//if(m_cam.getNbHwAcquiredFrames() > m_nb_triggers)
-		{
-			m_nb_triggers++;
-			//DEB_TRACE() << "CSoftTriggerTimer::on_timer : DoSoftwareTrigger - "<<m_nb_triggers;
-			TUCAM_Cap_DoSoftwareTrigger(m_cam.m_opCam.hIdxTUCam);
-		}
-	}
+	//DEB_TRACE() << "CSoftTriggerTimer::on_timer : DoSoftwareTrigger - "<<m_nb_triggers;
+	m_cam.sendSoftwareTrigger();
+}
+
+//---------------------------
+// @brief  ctor
+//---------------------------   
+CWatchdogTimer::CWatchdogTimer(Camera& cam) :
+CBaseTimer(WATCHDOG_MIN_TIMEOUT),
+m_cam(cam)
+{
+	DEB_CONSTRUCTOR();		
+}
+
+//---------------------------
+// @brief  dtor
+//---------------------------   
+CWatchdogTimer::~CWatchdogTimer()
+{
+	DEB_DESTRUCTOR();	
+	stop();
+};
 
-	//This Timer is oneshot, stop() it 
-	//stop();
+//---------------------------
+// @brief  on_timer
+//---------------------------   
+void CWatchdogTimer::on_timer()
+{
+	m_cam.checkWatchdog();
 }
 
 //-----------------------------------------------------
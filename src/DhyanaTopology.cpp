@@ -0,0 +1,198 @@
+//###########################################################################
+// This file is part of LImA, a Library for Image Acquisition
+//
+// Copyright (C) : 2009-2014
+// European Synchrotron Radiation Facility
+// BP 220, Grenoble 38043
+// FRANCE
+//
+// This is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This software is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//###########################################################################
+
+#include <algorithm>
+#include <sstream>
+#include <fstream>
+#include <thread>
+#include "DhyanaTopology.h"
+
+#ifdef WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+using namespace lima;
+using namespace lima::Dhyana;
+using namespace std;
+
+//---------------------------
+// @brief  Ctor
+//---------------------------
+CpuTopology::ScopedBinding::ScopedBinding(const std::vector<int>& cpus):
+m_bound(false)
+{
+	if(cpus.empty())
+		return;
+#ifdef WIN32
+	DWORD_PTR mask = 0;
+	for(size_t i = 0; i < cpus.size(); i++)
+	{
+		mask |= ((DWORD_PTR) 1) << cpus[i];
+	}
+	m_previous_mask = SetThreadAffinityMask(GetCurrentThread(), mask);
+	m_bound = (m_previous_mask != 0);
+#else
+	cpu_set_t cpu_set;
+	CPU_ZERO(&cpu_set);
+	if(pthread_getaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set) != 0)
+		return;
+	for(int cpu = 0; cpu < CPU_SETSIZE; cpu++)
+	{
+		if(CPU_ISSET(cpu, &cpu_set))
+			m_previous_cpus.push_back(cpu);
+	}
+	m_bound = bindCurrentThread(cpus);
+#endif
+}
+
+//---------------------------
+// @brief  Dtor, restore the previous binding
+//---------------------------
+CpuTopology::ScopedBinding::~ScopedBinding()
+{
+	if(!m_bound)
+		return;
+#ifdef WIN32
+	SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR) m_previous_mask);
+#else
+	bindCurrentThread(m_previous_cpus);
+#endif
+}
+
+//---------------------------
+//
+//---------------------------
+int CpuTopology::getNbCpus()
+{
+	return max((int) std::thread::hardware_concurrency(), 1);
+}
+
+//---------------------------
+//
+//---------------------------
+int CpuTopology::getNbNodes()
+{
+#ifdef WIN32
+	ULONG highest_node = 0;
+	if(!GetNumaHighestNodeNumber(&highest_node))
+		return 1;
+	return (int) highest_node + 1;
+#else
+	int nb_nodes = 0;
+	std::vector<int> cpus;
+	while(getNodeCpus(nb_nodes, cpus))
+	{
+		nb_nodes++;
+	}
+	return max(nb_nodes, 1);
+#endif
+}
+
+//---------------------------
+// @brief cpus of a NUMA node
+//---------------------------
+bool CpuTopology::getNodeCpus(int node, std::vector<int>& cpus)
+{
+	cpus.clear();
+	if(node < 0)
+		return false;
+#ifdef WIN32
+	ULONGLONG mask = 0;
+	if(node > 255 || !GetNumaNodeProcessorMask((UCHAR) node, &mask) || mask == 0)
+		return false;
+	for(int cpu = 0; cpu < 64; cpu++)
+	{
+		if(mask & (((ULONGLONG) 1) << cpu))
+			cpus.push_back(cpu);
+	}
+#else
+	//cpulist is a list of ranges : "0-7,16-23"
+	ostringstream path;
+	path << "/sys/devices/system/node/node" << node << "/cpulist";
+	ifstream file(path.str().c_str());
+	string range;
+	while(file.good() && getline(file, range, ','))
+	{
+		int first = 0, last = -1;
+		char dash = 0;
+		istringstream stream(range);
+		stream >> first;
+		last = (stream >> dash >> last) ? last : first;
+		for(int cpu = first; cpu <= last; cpu++)
+		{
+			cpus.push_back(cpu);
+		}
+	}
+#endif
+	return !cpus.empty();
+}
+
+//---------------------------
+// @brief restrict the calling thread to cpus
+//---------------------------
+bool CpuTopology::bindCurrentThread(const std::vector<int>& cpus)
+{
+	if(cpus.empty())
+		return false;
+#ifdef WIN32
+	DWORD_PTR mask = 0;
+	for(size_t i = 0; i < cpus.size(); i++)
+	{
+		mask |= ((DWORD_PTR) 1) << cpus[i];
+	}
+	return SetThreadAffinityMask(GetCurrentThread(), mask) != 0;
+#else
+	cpu_set_t cpu_set;
+	CPU_ZERO(&cpu_set);
+	for(size_t i = 0; i < cpus.size(); i++)
+	{
+		CPU_SET(cpus[i], &cpu_set);
+	}
+	return pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set) == 0;
+#endif
+}
+
+//---------------------------
+// @brief "0-3,8" like list of cpus
+//---------------------------
+std::string CpuTopology::toString(const std::vector<int>& cpus)
+{
+	ostringstream str;
+	for(size_t i = 0; i < cpus.size(); i++)
+	{
+		size_t last = i;
+		while(last + 1 < cpus.size() && cpus[last + 1] == cpus[last] + 1)
+		{
+			last++;
+		}
+		str << (i ? "," : "") << cpus[i];
+		if(last > i)
+		{
+			str << "-" << cpus[last];
+		}
+		i = last;
+	}
+	return str.str();
+}
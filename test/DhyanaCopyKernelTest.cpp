@@ -0,0 +1,208 @@
+//###########################################################################
+// This file is part of LImA, a Library for Image Acquisition
+//
+// Copyright (C) : 2009-2014
+// European Synchrotron Radiation Facility
+// BP 220, Grenoble 38043
+// FRANCE
+//
+// This is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This software is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//###########################################################################
+
+#include <vector>
+#include <algorithm>
+#include "DhyanaTest.h"
+#include "DhyanaCopyKernel.h"
+
+using namespace lima::Dhyana;
+using namespace std;
+
+//-----------------------------------------------------
+// @brief reproducible pixels, one in four saturated
+//-----------------------------------------------------
+static void fillPixels(vector<unsigned short>& pixels, unsigned seed)
+{
+	for(size_t i = 0; i < pixels.size(); i++)
+	{
+		seed = seed * 1103515245 + 12345;
+		unsigned value = (seed >> 8) & 0xffff;
+		pixels[i] = ((seed >> 28) & 3) == 0 ? 65535 : (unsigned short) value;
+	}
+}
+
+//-----------------------------------------------------
+// @brief scalar reference of CopyKernel::bin
+//-----------------------------------------------------
+static unsigned binnedPixel(const vector<unsigned short>& src, int stride, int x, int y, int bin_x, int bin_y, int depth)
+{
+	unsigned sum = 0;
+	for(int j = 0; j < bin_y; j++)
+	{
+		for(int i = 0; i < bin_x; i++)
+		{
+			sum += src[(y * bin_y + j) * stride + x * bin_x + i];
+		}
+	}
+	return (depth == 16 && sum > 65535) ? 65535 : sum;
+}
+
+//-----------------------------------------------------
+// @brief compare CopyKernel::bin with the reference, false at the first wrong pixel,
+// the src rows are stride pixels apart
+//-----------------------------------------------------
+static bool checkBin(int width, int height, int bin_x, int bin_y, int depth, int stride = 0)
+{
+	stride = max(stride, width);
+	vector<unsigned short> src(stride * height);
+	fillPixels(src, width * 31 + height * 7 + bin_x * 3 + bin_y);
+	int out_width = width / bin_x;
+	int out_height = height / bin_y;
+	//a guard after the binned image catches writes beyond it
+	const unsigned guard = 0xdeadbeef;
+	vector<unsigned> dst(out_width * out_height + 16, guard);
+	CopyKernel::bin(&dst[0], depth, &src[0], stride * sizeof(unsigned short), width, height, bin_x, bin_y);
+
+	for(int y = 0; y < out_height; y++)
+	{
+		for(int x = 0; x < out_width; x++)
+		{
+			unsigned expected = binnedPixel(src, stride, x, y, bin_x, bin_y, depth);
+			unsigned value = (depth == 16) ? ((unsigned short*) &dst[0])[y * out_width + x] : dst[y * out_width + x];
+			if(value != expected)
+			{
+				std::cerr << "bin " << bin_x << "x" << bin_y << " of " << width << "x" << height << " in " << depth
+						  << " bits : pixel (" << x << ", " << y << ") = " << value << " instead of " << expected << std::endl;
+				return false;
+			}
+		}
+	}
+	size_t image_words = (depth == 16) ? (out_width * out_height + 1) / 2 : out_width * out_height;
+	for(size_t i = image_words; i < dst.size(); i++)
+	{
+		if(dst[i] != guard)
+		{
+			std::cerr << "bin " << bin_x << "x" << bin_y << " of " << width << "x" << height << " wrote beyond the image" << std::endl;
+			return false;
+		}
+	}
+	return true;
+}
+
+//-----------------------------------------------------
+// @brief widths not multiple of the binning nor of the vector width leave a scalar tail
+//-----------------------------------------------------
+DHYANA_TEST(testCopyKernelBinOddWidths)
+{
+	const int widths[] = {1, 3, 15, 17, 31, 33, 37, 63, 65, 101, 2047};
+	const int bins[] = {1, 2, 3, 4, 5};
+	for(size_t w = 0; w < sizeof(widths) / sizeof(widths[0]); w++)
+	{
+		for(size_t bx = 0; bx < sizeof(bins) / sizeof(bins[0]); bx++)
+		{
+			for(size_t by = 0; by < sizeof(bins) / sizeof(bins[0]); by++)
+			{
+				if(widths[w] < bins[bx])
+					continue;
+				int height = bins[by] * 3;
+				DHYANA_CHECK(checkBin(widths[w], height, bins[bx], bins[by], 16));
+				DHYANA_CHECK(checkBin(widths[w], height, bins[bx], bins[by], 32));
+			}
+		}
+	}
+}
+
+//-----------------------------------------------------
+// @brief 16 bits sums saturate, 32 bits sums of saturated pixels do not
+//-----------------------------------------------------
+DHYANA_TEST(testCopyKernelBinSaturation)
+{
+	const int width = 67;
+	const int height = 8;
+	vector<unsigned short> src(width * height, 65535);
+	vector<unsigned> dst(width * height, 0);
+
+	CopyKernel::bin(&dst[0], 16, &src[0], width * 2, width, height, 2, 2);
+	unsigned short* dst16 = (unsigned short*) &dst[0];
+	for(int i = 0; i < (width / 2) * (height / 2); i++)
+	{
+		DHYANA_CHECK_EQUAL(dst16[i], 65535);
+	}
+
+	CopyKernel::bin(&dst[0], 32, &src[0], width * 2, width, height, 4, 4);
+	for(int i = 0; i < (width / 4) * (height / 4); i++)
+	{
+		DHYANA_CHECK_EQUAL(dst[i], 16u * 65535u);
+	}
+
+	//a sum just below the limit is kept as is
+	for(size_t i = 0; i < src.size(); i++)
+	{
+		src[i] = (i % 2) ? 32767 : 32768;
+	}
+	CopyKernel::bin(&dst[0], 16, &src[0], width * 2, width, height, 2, 1);
+	for(int i = 0; i < (width / 2) * height; i++)
+	{
+		DHYANA_CHECK_EQUAL(dst16[i], 65535);
+	}
+}
+
+//-----------------------------------------------------
+// @brief full size images, as binned on the copy to the Lima buffer
+//-----------------------------------------------------
+DHYANA_TEST(testCopyKernelBinLargeImage)
+{
+	DHYANA_CHECK(checkBin(2048, 64, 2, 2, 16));
+	DHYANA_CHECK(checkBin(2048, 64, 2, 2, 32));
+	DHYANA_CHECK(checkBin(2048, 63, 3, 7, 32));
+	DHYANA_CHECK(checkBin(1999, 60, 4, 3, 16));
+}
+
+//-----------------------------------------------------
+// @brief padded src rows (TUCAM width step) : the padding is never binned
+//-----------------------------------------------------
+DHYANA_TEST(testCopyKernelBinStride)
+{
+	DHYANA_CHECK(checkBin(17, 6, 2, 2, 16, 24));
+	DHYANA_CHECK(checkBin(33, 9, 3, 3, 32, 40));
+	DHYANA_CHECK(checkBin(2047, 16, 2, 2, 16, 2048));
+	DHYANA_CHECK(checkBin(1999, 12, 4, 3, 32, 2064));
+}
+
+//-----------------------------------------------------
+// @brief padded src rows are copied into contiguous dst rows
+//-----------------------------------------------------
+DHYANA_TEST(testCopyKernelCopyRowsStride)
+{
+	const int width = 1000;
+	const int stride = 1024;
+	const int height = 300;
+	vector<unsigned short> src(stride * height);
+	fillPixels(src, 42);
+	vector<unsigned short> dst(width * height + 8, 0xbeef);
+	CopyKernel::copyRows(&dst[0], &src[0], stride * sizeof(unsigned short), width * sizeof(unsigned short), height);
+
+	int nb_wrong = 0;
+	for(int y = 0; y < height; y++)
+	{
+		for(int x = 0; x < width; x++)
+		{
+			nb_wrong += (dst[y * width + x] != src[y * stride + x]);
+		}
+	}
+	DHYANA_CHECK_EQUAL(nb_wrong, 0);
+	for(size_t i = width * height; i < dst.size(); i++)
+	{
+		DHYANA_CHECK_EQUAL(dst[i], 0xbeef);
+	}
+}
@@ -0,0 +1,125 @@
+//###########################################################################
+// This file is part of LImA, a Library for Image Acquisition
+//
+// Copyright (C) : 2009-2014
+// European Synchrotron Radiation Facility
+// BP 220, Grenoble 38043
+// FRANCE
+//
+// This is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This software is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//###########################################################################
+
+#include "DhyanaTest.h"
+#include "DhyanaFrameQueue.h"
+
+using namespace lima::Dhyana;
+
+//-----------------------------------------------------
+// @brief frame descriptor numbered by its TUCAM index
+//-----------------------------------------------------
+static FrameQueue::Desc makeFrame(unsigned index)
+{
+	FrameQueue::Desc desc = FrameQueue::Desc();
+	desc.index = index;
+	desc.size = index * 2;
+	return desc;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+DHYANA_TEST(testFrameQueueEmpty)
+{
+	FrameQueue queue;
+	queue.reset(4);
+	FrameQueue::Desc desc;
+	DHYANA_CHECK_EQUAL(queue.capacity(), 4);
+	DHYANA_CHECK_EQUAL(queue.size(), 0);
+	DHYANA_CHECK(!queue.front(desc));
+
+	//a null capacity still holds one frame
+	queue.reset(0);
+	DHYANA_CHECK_EQUAL(queue.capacity(), 1);
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+DHYANA_TEST(testFrameQueueFull)
+{
+	FrameQueue queue;
+	queue.reset(3);
+	DHYANA_CHECK(queue.push(makeFrame(0)));
+	DHYANA_CHECK(queue.push(makeFrame(1)));
+	DHYANA_CHECK(queue.push(makeFrame(2)));
+	DHYANA_CHECK(!queue.push(makeFrame(3)));
+	DHYANA_CHECK_EQUAL(queue.size(), 3);
+	DHYANA_CHECK_EQUAL(queue.getHighWaterMark(), 3);
+
+	//the refused frame did not overwrite the oldest one
+	FrameQueue::Desc desc;
+	DHYANA_CHECK(queue.front(desc));
+	DHYANA_CHECK_EQUAL(desc.index, 0u);
+}
+
+//-----------------------------------------------------
+// @brief the frames come out in order while the ring wraps around many times
+//-----------------------------------------------------
+DHYANA_TEST(testFrameQueueWrapAround)
+{
+	FrameQueue queue;
+	queue.reset(3);
+	unsigned next_push = 0;
+	unsigned next_pop = 0;
+	for(int cycle = 0; cycle < 100; cycle++)
+	{
+		//alternate between 1 and 3 frames in flight so that head and tail cross the ring end at every offset
+		int nb_frames = (cycle % 3) + 1;
+		for(int i = 0; i < nb_frames; i++)
+		{
+			DHYANA_CHECK(queue.push(makeFrame(next_push++)));
+		}
+		DHYANA_CHECK_EQUAL(queue.size(), nb_frames);
+		for(int i = 0; i < nb_frames; i++)
+		{
+			FrameQueue::Desc desc;
+			DHYANA_CHECK(queue.front(desc));
+			DHYANA_CHECK_EQUAL(desc.index, next_pop);
+			DHYANA_CHECK_EQUAL(desc.size, next_pop * 2);
+			queue.pop();
+			next_pop++;
+		}
+		DHYANA_CHECK_EQUAL(queue.size(), 0);
+	}
+	DHYANA_CHECK_EQUAL(queue.getHighWaterMark(), 3);
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+DHYANA_TEST(testFrameQueueReset)
+{
+	FrameQueue queue;
+	queue.reset(2);
+	queue.push(makeFrame(0));
+	queue.push(makeFrame(1));
+	queue.reset(5);
+	FrameQueue::Desc desc;
+	DHYANA_CHECK_EQUAL(queue.size(), 0);
+	DHYANA_CHECK_EQUAL(queue.getHighWaterMark(), 0);
+	DHYANA_CHECK(!queue.front(desc));
+	DHYANA_CHECK(queue.push(makeFrame(7)));
+	DHYANA_CHECK(queue.front(desc));
+	DHYANA_CHECK_EQUAL(desc.index, 7u);
+}
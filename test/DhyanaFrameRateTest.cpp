@@ -0,0 +1,128 @@
+//###########################################################################
+// This file is part of LImA, a Library for Image Acquisition
+//
+// Copyright (C) : 2009-2014
+// European Synchrotron Radiation Facility
+// BP 220, Grenoble 38043
+// FRANCE
+//
+// This is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This software is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//###########################################################################
+
+#include "DhyanaTest.h"
+#include "DhyanaFrameRate.h"
+
+using namespace lima::Dhyana;
+
+//-----------------------------------------------------
+// @brief nb_frames frames every period (s), from start (s), return the last frame time
+//-----------------------------------------------------
+static double addFrames(FrameRateMeter& meter, double start, double period, int nb_frames)
+{
+	for(int i = 0; i < nb_frames; i++)
+	{
+		meter.add(start + i * period);
+	}
+	return start + (nb_frames - 1) * period;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+DHYANA_TEST(testFrameRateNoFrame)
+{
+	FrameRateMeter meter;
+	meter.reset(0.01);
+	DHYANA_CHECK_EQUAL(meter.getWindowRate(10.0), 0.0);
+	DHYANA_CHECK_EQUAL(meter.getNbStalls(10.0), 0);
+	DHYANA_CHECK_EQUAL(meter.getMaxGap(10.0), 0.0);
+	DHYANA_CHECK_EQUAL(meter.getTimeSinceLastFrame(10.0), 0.0);
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+DHYANA_TEST(testFrameRateSteady)
+{
+	FrameRateMeter meter;
+	meter.reset(0.01);
+	double last = addFrames(meter, 100.0, 0.01, 300);
+	DHYANA_CHECK_CLOSE(meter.getInstantRate(), 100.0, 1e-6);
+	DHYANA_CHECK_CLOSE(meter.getAverageRate(), 100.0, 1e-6);
+	DHYANA_CHECK_CLOSE(meter.getWindowRate(last + 0.005), 100.0, 1e-6);
+	DHYANA_CHECK_CLOSE(meter.getMinWindowRate(), 100.0, 1.0);
+	DHYANA_CHECK_EQUAL(meter.getNbStalls(last + 0.005), 0);
+	DHYANA_CHECK_CLOSE(meter.getMaxGap(last + 0.005), 0.01, 1e-9);
+	DHYANA_CHECK_CLOSE(meter.getTimeSinceLastFrame(last + 0.005), 0.005, 1e-9);
+}
+
+//-----------------------------------------------------
+// @brief a stall is detected while it lasts, then counted once its frame comes
+//-----------------------------------------------------
+DHYANA_TEST(testFrameRateStall)
+{
+	FrameRateMeter meter;
+	meter.reset(0.01, 3.0);
+	double last = addFrames(meter, 0.0, 0.01, 50);
+
+	//not yet a stall at 3 periods, one beyond
+	DHYANA_CHECK_EQUAL(meter.getNbStalls(last + 0.029), 0);
+	DHYANA_CHECK_EQUAL(meter.getNbStalls(last + 0.031), 1);
+	DHYANA_CHECK_CLOSE(meter.getMaxGap(last + 0.5), 0.5, 1e-9);
+	DHYANA_CHECK_CLOSE(meter.getTimeSinceLastFrame(last + 0.5), 0.5, 1e-9);
+	//the rate decays while no frame comes
+	DHYANA_CHECK(meter.getWindowRate(last + 0.5) < 60.0);
+	DHYANA_CHECK_EQUAL(meter.getWindowRate(last + 1.5), 0.0);
+
+	//the frame ending the stall does not count it twice
+	meter.add(last + 0.5);
+	DHYANA_CHECK_EQUAL(meter.getNbStalls(last + 0.5), 1);
+	DHYANA_CHECK_CLOSE(meter.getMaxGap(last + 0.5), 0.5, 1e-9);
+	last = addFrames(meter, last + 0.51, 0.01, 10);
+	DHYANA_CHECK_EQUAL(meter.getNbStalls(last), 1);
+}
+
+//-----------------------------------------------------
+// @brief without an expected period the stalls are compared with the moving average of the period
+//-----------------------------------------------------
+DHYANA_TEST(testFrameRateStallWithoutPeriod)
+{
+	FrameRateMeter meter;
+	meter.reset(0.0, 3.0);
+	double last = addFrames(meter, 0.0, 0.02, 50);
+	DHYANA_CHECK_EQUAL(meter.getNbStalls(last + 0.05), 0);
+	DHYANA_CHECK_EQUAL(meter.getNbStalls(last + 0.07), 1);
+
+	//a single frame gives no period to compare with
+	meter.reset(0.0, 3.0);
+	meter.add(0.0);
+	DHYANA_CHECK_EQUAL(meter.getNbStalls(100.0), 0);
+}
+
+//-----------------------------------------------------
+// @brief once stopped the results are the ones at the last frame
+//-----------------------------------------------------
+DHYANA_TEST(testFrameRateStop)
+{
+	FrameRateMeter meter;
+	meter.reset(0.01, 3.0);
+	double last = addFrames(meter, 0.0, 0.01, 300);
+	meter.stop();
+	DHYANA_CHECK_CLOSE(meter.getWindowRate(last + 10.0), 100.0, 1e-6);
+	DHYANA_CHECK_EQUAL(meter.getNbStalls(last + 10.0), 0);
+	DHYANA_CHECK_EQUAL(meter.getTimeSinceLastFrame(last + 10.0), 0.0);
+
+	meter.reset(0.01, 3.0);
+	DHYANA_CHECK_EQUAL(meter.getWindowRate(last + 10.0), 0.0);
+}
@@ -0,0 +1,125 @@
+//###########################################################################
+// This file is part of LImA, a Library for Image Acquisition
+//
+// Copyright (C) : 2009-2014
+// European Synchrotron Radiation Facility
+// BP 220, Grenoble 38043
+// FRANCE
+//
+// This is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This software is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//###########################################################################
+
+#include <math.h>
+#include "DhyanaTest.h"
+#include "DhyanaHistogram.h"
+
+using namespace lima::Dhyana;
+using namespace std;
+
+//-----------------------------------------------------
+// @brief upper bound of the bucket a single duration falls in
+//-----------------------------------------------------
+static double getBucketOf(double duration)
+{
+	LatencyHistogram histogram;
+	histogram.add(duration);
+	vector<double> bounds;
+	vector<int> counts;
+	histogram.getBuckets(bounds, counts);
+	return (bounds.size() == 1 && counts[0] == 1) ? bounds[0] : -1.0;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+DHYANA_TEST(testHistogramFirstBucket)
+{
+	DHYANA_CHECK_EQUAL(getBucketOf(0.0), HISTOGRAM_MIN_TIME);
+	DHYANA_CHECK_EQUAL(getBucketOf(-1.0), HISTOGRAM_MIN_TIME);
+	DHYANA_CHECK_EQUAL(getBucketOf(HISTOGRAM_MIN_TIME), HISTOGRAM_MIN_TIME);
+	DHYANA_CHECK_EQUAL(getBucketOf(HISTOGRAM_MIN_TIME * (1 + 1e-9)), LatencyHistogram::getBucketBound(1));
+}
+
+//-----------------------------------------------------
+// @brief each octave is split in buckets of equal width
+//-----------------------------------------------------
+DHYANA_TEST(testHistogramBucketBounds)
+{
+	for(int bucket = 1; bucket < HISTOGRAM_NB_BUCKETS; bucket++)
+	{
+		double lower = LatencyHistogram::getBucketBound(bucket - 1);
+		double upper = LatencyHistogram::getBucketBound(bucket);
+		int octave = (bucket - 1) / HISTOGRAM_BUCKETS_PER_OCTAVE;
+		double octave_start = ldexp(HISTOGRAM_MIN_TIME, octave);
+		DHYANA_CHECK_CLOSE(upper - lower, octave_start / HISTOGRAM_BUCKETS_PER_OCTAVE, octave_start * 1e-12);
+		//width of 25% down to 14% of the lower bound
+		DHYANA_CHECK((upper - lower) / lower <= 0.25 + 1e-12);
+		DHYANA_CHECK((upper - lower) / lower >= 0.14);
+	}
+	DHYANA_CHECK_CLOSE(LatencyHistogram::getBucketBound(HISTOGRAM_NB_BUCKETS - 1),
+					   ldexp(HISTOGRAM_MIN_TIME, HISTOGRAM_NB_OCTAVES), 1e-9);
+}
+
+//-----------------------------------------------------
+// @brief a duration just inside either edge of a bucket is counted in it
+//-----------------------------------------------------
+DHYANA_TEST(testHistogramBucketEdges)
+{
+	for(int bucket = 1; bucket < HISTOGRAM_NB_BUCKETS; bucket++)
+	{
+		double lower = LatencyHistogram::getBucketBound(bucket - 1);
+		double upper = LatencyHistogram::getBucketBound(bucket);
+		DHYANA_CHECK_EQUAL(getBucketOf(lower * (1 + 1e-9)), upper);
+		DHYANA_CHECK_EQUAL(getBucketOf(upper * (1 - 1e-9)), upper);
+	}
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+DHYANA_TEST(testHistogramOverflow)
+{
+	double last_bound = LatencyHistogram::getBucketBound(HISTOGRAM_NB_BUCKETS - 1);
+	DHYANA_CHECK_EQUAL(getBucketOf(last_bound * 2), last_bound);
+	DHYANA_CHECK_EQUAL(getBucketOf(1e9), last_bound);
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+DHYANA_TEST(testHistogramPercentile)
+{
+	LatencyHistogram histogram;
+	DHYANA_CHECK_EQUAL(histogram.getPercentile(50), 0.0);
+
+	//1 to 100 ms
+	for(int i = 1; i <= 100; i++)
+	{
+		histogram.add(i * 1e-3);
+	}
+	DHYANA_CHECK_EQUAL(histogram.getCount(), 100);
+	DHYANA_CHECK_EQUAL(histogram.getMax(), 0.1);
+
+	//the percentile is the upper bound of its bucket, within the bucket resolution
+	double p50 = histogram.getPercentile(50);
+	DHYANA_CHECK(p50 >= 50e-3 && p50 <= 50e-3 * 1.25);
+	double p99 = histogram.getPercentile(99);
+	DHYANA_CHECK(p99 >= 99e-3 && p99 <= 0.1);
+	//never beyond the largest duration seen
+	DHYANA_CHECK_EQUAL(histogram.getPercentile(100), 0.1);
+
+	histogram.reset();
+	DHYANA_CHECK_EQUAL(histogram.getCount(), 0);
+	DHYANA_CHECK_EQUAL(histogram.getMax(), 0.0);
+}
@@ -0,0 +1,90 @@
+//###########################################################################
+// This file is part of LImA, a Library for Image Acquisition
+//
+// Copyright (C) : 2009-2014
+// European Synchrotron Radiation Facility
+// BP 220, Grenoble 38043
+// FRANCE
+//
+// This is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This software is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//###########################################################################
+
+#include "DhyanaTest.h"
+#include "lima/Exceptions.h"
+#include "lima/CtControl.h"
+#include "lima/CtAcquisition.h"
+#include "DhyanaCamera.h"
+#include "DhyanaInterface.h"
+#include "DhyanaTimer.h"
+
+using namespace lima;
+using namespace lima::Dhyana;
+using namespace std;
+
+static const int    SCAN_NB_POINTS     = 10000;
+static const double SCAN_EXP_TIME      = 0.001; // (s)
+static const double SCAN_POINT_TIMEOUT = 5.0;   // (s) without the frame of a point, the scan is aborted
+
+//-----------------------------------------------------
+// @brief step scan of SCAN_NB_POINTS one-frame points, each released as soon as the previous one is done
+//-----------------------------------------------------
+DHYANA_BENCHMARK(scanDeadTime)
+{
+	try
+	{
+		Camera cam(1);
+		Interface hw(cam);
+		CtControl ctrl(&hw);
+		ctrl.acquisition()->setTriggerMode(IntTrig);
+		ctrl.acquisition()->setAcqExpoTime(SCAN_EXP_TIME);
+		ctrl.acquisition()->setAcqNbFrames(SCAN_NB_POINTS);
+		cam.armScan(SCAN_NB_POINTS, 1);
+		ctrl.prepareAcq();
+		ctrl.startAcq();
+
+		double t0 = CBaseTimer::now();
+		for(int point = 0; point < SCAN_NB_POINTS; point++)
+		{
+			cam.nextPoint();
+			int nb_points_released, nb_points_done;
+			double point_start = CBaseTimer::now();
+			do
+			{
+				cam.getScanProgress(nb_points_released, nb_points_done);
+			} while(nb_points_done <= point && CBaseTimer::now() - point_start < SCAN_POINT_TIMEOUT);
+			if(nb_points_done <= point)
+			{
+				cerr << "no frame for the point " << point << ", scan aborted" << endl;
+				DHYANA_CHECK(nb_points_done > point);
+				break;
+			}
+		}
+		double scan_time = CBaseTimer::now() - t0;
+		ctrl.stopAcq();
+
+		int count;
+		double p50, p99, max_dead_time;
+		cam.getScanDeadTime(count, p50, p99, max_dead_time);
+		cout << "scan of " << count << " point(s) in " << scan_time << " s, dead time (ms) :"
+			 << " p50 " << p50 * 1000
+			 << " p99 " << p99 * 1000
+			 << " max " << max_dead_time * 1000 << endl;
+		DHYANA_CHECK_EQUAL(count, SCAN_NB_POINTS);
+	}
+	catch(Exception& e)
+	{
+		cerr << "scanDeadTime : " << e.getErrMsg() << endl;
+		DHYANA_CHECK(false);
+	}
+}
@@ -0,0 +1,51 @@
+//###########################################################################
+// This file is part of LImA, a Library for Image Acquisition
+//
+// Copyright (C) : 2009-2014
+// European Synchrotron Radiation Facility
+// BP 220, Grenoble 38043
+// FRANCE
+//
+// This is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This software is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//###########################################################################
+
+#include <string.h>
+#include "DhyanaTest.h"
+
+using namespace lima::Dhyana::Test;
+using namespace std;
+
+//-----------------------------------------------------
+// @brief run all the registered tests, the exit code is the number of failed tests
+// with --benchmark, run the benchmarks instead : they need a camera
+//-----------------------------------------------------
+int main(int argc, char* argv[])
+{
+	bool benchmark = (argc > 1 && strcmp(argv[1], "--benchmark") == 0);
+	int nb_failed_tests = 0;
+	vector<TestCase>& tests = benchmark ? getBenchmarks() : getTests();
+	for(size_t i = 0; i < tests.size(); i++)
+	{
+		getNbFailures() = 0;
+		tests[i].func();
+		bool passed = (getNbFailures() == 0);
+		cout << (passed ? "[ OK ] " : "[FAIL] ") << tests[i].name << endl;
+		if(!passed)
+		{
+			nb_failed_tests++;
+		}
+	}
+	cout << tests.size() - nb_failed_tests << " / " << tests.size() << " tests passed" << endl;
+	return nb_failed_tests;
+}
@@ -0,0 +1,126 @@
+//###########################################################################
+// This file is part of LImA, a Library for Image Acquisition
+//
+// Copyright (C) : 2009-2011
+// European Synchrotron Radiation Facility
+// BP 220, Grenoble 38043
+// FRANCE
+//
+// This is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This software is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//###########################################################################
+//
+// DhyanaTest.h
+// Created on: October 24, 2018
+// Author: Arafat NOUREDDINE
+
+#ifndef DHYANATEST_H_
+#define DHYANATEST_H_
+
+#include <iostream>
+#include <vector>
+
+namespace lima
+{
+namespace Dhyana
+{
+namespace Test
+{
+
+typedef void (*TestFunc)();
+
+struct TestCase
+{
+    const char* name;
+    TestFunc    func;
+};
+
+// all the tests of the executable, registered by DHYANA_TEST before main()
+inline std::vector<TestCase>& getTests()
+{
+    static std::vector<TestCase> tests;
+    return tests;
+}
+
+// number of failed checks of the running test
+inline int& getNbFailures()
+{
+    static int nb_failures = 0;
+    return nb_failures;
+}
+
+// benchmarks needing the camera, registered by DHYANA_BENCHMARK, only run with --benchmark
+inline std::vector<TestCase>& getBenchmarks()
+{
+    static std::vector<TestCase> benchmarks;
+    return benchmarks;
+}
+
+struct TestRegistrar
+{
+    TestRegistrar(const char* name, TestFunc func, bool benchmark = false)
+    {
+        TestCase test = {name, func};
+        (benchmark ? getBenchmarks() : getTests()).push_back(test);
+    }
+};
+
+} // namespace Test
+} // namespace Dhyana
+} // namespace lima
+
+#define DHYANA_TEST(name)                                                                   \
+    static void name();                                                                     \
+    static lima::Dhyana::Test::TestRegistrar name##_registrar(#name, name);                 \
+    static void name()
+
+#define DHYANA_BENCHMARK(name)                                                              \
+    static void name();                                                                     \
+    static lima::Dhyana::Test::TestRegistrar name##_registrar(#name, name, true);           \
+    static void name()
+
+// a failed check is reported and the test goes on
+#define DHYANA_CHECK(cond)                                                                  \
+    do                                                                                      \
+    {                                                                                       \
+        if(!(cond))                                                                         \
+        {                                                                                   \
+            std::cerr << __FILE__ << ":" << __LINE__ << ": check failed : " #cond << std::endl; \
+            lima::Dhyana::Test::getNbFailures()++;                                          \
+        }                                                                                   \
+    } while(0)
+
+#define DHYANA_CHECK_EQUAL(a, b)                                                            \
+    do                                                                                      \
+    {                                                                                       \
+        if(!((a) == (b)))                                                                   \
+        {                                                                                   \
+            std::cerr << __FILE__ << ":" << __LINE__ << ": check failed : " #a " == " #b   \
+                      << " (" << (a) << " != " << (b) << ")" << std::endl;                  \
+            lima::Dhyana::Test::getNbFailures()++;                                          \
+        }                                                                                   \
+    } while(0)
+
+#define DHYANA_CHECK_CLOSE(a, b, tolerance)                                                 \
+    do                                                                                      \
+    {                                                                                       \
+        double delta_ = (double) (a) - (double) (b);                                        \
+        if(delta_ > (tolerance) || -delta_ > (tolerance))                                   \
+        {                                                                                   \
+            std::cerr << __FILE__ << ":" << __LINE__ << ": check failed : " #a " ~ " #b    \
+                      << " (" << (a) << " != " << (b) << ")" << std::endl;                  \
+            lima::Dhyana::Test::getNbFailures()++;                                          \
+        }                                                                                   \
+    } while(0)
+
+#endif /* DHYANATEST_H_ */